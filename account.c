@@ -0,0 +1,113 @@
+/* GoomwWM, Get out of my way, Window Manager!
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+
+// count X resources and measure memory, so slow leaks in long sessions show up.
+// goomwwm -cli -resources prints the report
+
+void account(int category, long n)
+{
+	accounts[category] += n;
+}
+
+// refresh the measured categories
+void account_measure()
+{
+	int i; Window w; long bytes = 0;
+	winlist_ascend(windows, i, w)
+	{
+		wincache *cache = windows->data[i];
+		if (!cache) continue;
+		bytes += sizeof(wincache) + sizeof(winundo) * cache->undo.size;
+		if (cache->ewmh) bytes += sizeof(winundo);
+	}
+	accounts[ACCOUNT_wincache] = windows->len;
+	accounts[ACCOUNT_wincache_bytes] = bytes;
+	accounts[ACCOUNT_arena_bytes] = client_arena.bytes + xattr_arena.bytes;
+	accounts[ACCOUNT_string_bytes] = interned_bytes;
+	accounts[ACCOUNT_spare_lists] = winlist_pooled;
+	accounts[ACCOUNT_rss_kb] = 0;
+#ifdef __linux__
+	FILE *f = fopen("/proc/self/statm", "r");
+	if (f)
+	{
+		long size, rss;
+		if (fscanf(f, "%ld %ld", &size, &rss) == 2)
+			accounts[ACCOUNT_rss_kb] = rss * (sysconf(_SC_PAGESIZE) / 1024);
+		fclose(f);
+	}
+#endif
+}
+
+// true if a category never shrank over a full window of samples, and grew overall
+int account_growing(int category)
+{
+	int i;
+	if (account_sampled < ACCOUNTSAMPLES) return 0;
+	// oldest sample is the next slot to be overwritten
+	int first = account_sampled % ACCOUNTSAMPLES, prev = first;
+	for (i = 1; i < ACCOUNTSAMPLES; i++)
+	{
+		int s = (first+i) % ACCOUNTSAMPLES;
+		if (account_samples[s][category] < account_samples[prev][category]) return 0;
+		prev = s;
+	}
+	return account_samples[prev][category] > account_samples[first][category];
+}
+
+// periodic sample. warns once when a category starts growing
+void account_sample(void *data)
+{
+	int i, was[ACCOUNTN];
+	for (i = 0; i < ACCOUNTN; i++) was[i] = account_growing(i);
+	account_measure();
+	memmove(account_samples[account_sampled++ % ACCOUNTSAMPLES], accounts, sizeof(accounts));
+	for (i = 0; i < ACCOUNTN; i++)
+		if (!was[i] && account_growing(i))
+			fprintf(stderr, "goomwwm: %s has grown for %d minutes, now %ld\n",
+				account_names[i], ACCOUNTSAMPLES * ACCOUNTMS / 60000, accounts[i]);
+	timer_add(ACCOUNTMS, account_sample, NULL);
+}
+
+// report. returns the number of categories flagged as growing
+int account_dump(FILE *f)
+{
+	int i, j, growing = 0;
+	account_measure();
+	for (i = 0; i < ACCOUNTN; i++)
+	{
+		long lo = accounts[i], hi = accounts[i];
+		for (j = 0; j < MIN(account_sampled, ACCOUNTSAMPLES); j++)
+		{
+			lo = MIN(lo, account_samples[j][i]);
+			hi = MAX(hi, account_samples[j][i]);
+		}
+		int grow = account_growing(i);
+		fprintf(f, "%-16s %10ld  (min %ld max %ld)%s\n", account_names[i], accounts[i], lo, hi, grow ? "  GROWING": "");
+		growing += grow;
+	}
+	return growing;
+}
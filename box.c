@@ -34,6 +34,7 @@ box* box_create(Window parent, bitmap flags, short x, short y, short w, short h,
 	box_color(b, color);
 
 	b->window = XCreateSimpleWindow(display, b->parent, 0, 0, 1, 1, 0, None, b->color);
+	account(ACCOUNT_windows, 1);
 
 	if (b->flags & BOX_OVERRIDE)
 	{
@@ -77,5 +78,6 @@ void box_draw(box *b)
 void box_free(box *b)
 {
 	XDestroyWindow(display, b->window);
+	account(ACCOUNT_windows, -1);
 	free(b);
 }
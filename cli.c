@@ -24,38 +24,141 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 */
 
-void cli_message(Atom atom, char *cmd)
+Window cli_message(Atom atom, char *cmd)
 {
 	Window cli = XCreateSimpleWindow(display, root, 0, 0, 1, 1, 0, None, None);
+	XSelectInput(display, cli, PropertyChangeMask);
 	if (cmd) window_set_text_prop(cli, gatoms[GOOMWWM_MESSAGE], cmd);
 	window_send_message(root, cli, atom, 0, SubstructureNotifyMask | SubstructureRedirectMask);
+	return cli;
 }
 
-// command line interface
+// wait up to 2s for goomwwm to set a reply property on our cli window
+char* cli_reply(Window cli, Atom atom)
+{
+	int i; XEvent ev;
+	for (i = 0; i < 200; i++)
+	{
+		while (XCheckTypedWindowEvent(display, cli, PropertyNotify, &ev))
+			if (ev.xproperty.atom == atom && ev.xproperty.state == PropertyNewValue)
+				return window_get_text_prop(cli, atom);
+		usleep(10000);
+	}
+	return NULL;
+}
+
+// connect to the control socket of the running instance, or -1 to fall back to X messages
+int cli_connect()
+{
+	char *path = ipc_path();
+	if (!path) return -1;
+	struct sockaddr_un sa; memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strcpy(sa.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) return -1;
+	if (connect(fd, (struct sockaddr*)&sa, sizeof(sa)) < 0)
+	{
+		close(fd);
+		return -1;
+	}
+	struct timeval tv = { IPCTIMEOUT, 0 };
+	setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+	return fd;
+}
+
+int cli_read(int fd, char *buf, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t n = read(fd, buf, len);
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return 0;
+		buf += n; len -= n;
+	}
+	return 1;
+}
+
+// send one request over the socket and copy the reply to stdout/stderr.
+// returns goomwwm's exit status, or -1 if the connection failed
+int cli_request(int fd, int cmd, char *arg)
+{
+	char head[64]; int i = 0, status, len = arg ? strlen(arg): 0;
+	unsigned long outlen, errlen;
+	snprintf(head, sizeof(head), "%s %d\n", gatom_names[cmd] + IPCPREFIX, len);
+	if (!ipc_send(fd, head, strlen(head)) || !ipc_send(fd, arg, len))
+		return -1;
+	// reply header is short. a byte at a time is fine
+	while (i < sizeof(head)-1 && cli_read(fd, head+i, 1) && head[i] != '\n') i++;
+	head[i] = 0;
+	if (sscanf(head, "%d %lu %lu", &status, &outlen, &errlen) != 3)
+		return -1;
+	char *buf = allocate(outlen + errlen + 1);
+	int ok = cli_read(fd, buf, outlen + errlen);
+	if (ok)
+	{
+		fwrite(buf, 1, outlen, stdout);
+		fwrite(buf + outlen, 1, errlen, stderr);
+	}
+	free(buf);
+	return ok ? status: -1;
+}
+
+// one command, over the socket when goomwwm is listening, otherwise as an X message
+int cli_send(int fd, int cmd, char *arg)
+{
+	if (fd < 0)
+	{
+		cli_message(gatoms[cmd], arg);
+		return EXIT_SUCCESS;
+	}
+	int status = cli_request(fd, cmd, arg);
+	if (status < 0) fprintf(stderr, "goomwwm: no reply to %s\n", gatom_names[cmd] + IPCPREFIX);
+	return status < 0 ? EXIT_FAILURE: status;
+}
+
+// commands that print a result. over X the reply arrives as a property on our window
+int cli_query(int fd, int cmd)
+{
+	if (fd >= 0) return cli_send(fd, cmd, NULL);
+	char *reply = cli_reply(cli_message(gatoms[cmd], NULL), gatoms[cmd]);
+	if (!reply) return EXIT_FAILURE;
+	printf("%s", reply);
+	// the X reply has no status, only the report text
+	int growing = cmd == GOOMWWM_RESOURCES && strstr(reply, "GROWING");
+	free(reply);
+	return growing ? EXIT_FAILURE: EXIT_SUCCESS;
+}
+
+// command line interface. the exit status is non-zero if any command failed
 int cli_main(int argc, char *argv[])
 {
-	char *arg;
+	char *arg; int fd = cli_connect(), status = EXIT_SUCCESS;
 
 	if ((arg = find_arg_str(argc, argv, "-log", NULL)))
-		cli_message(gatoms[GOOMWWM_LOG], arg);
+		status |= cli_send(fd, GOOMWWM_LOG, arg);
 
 	if (find_arg(argc, argv, "-restart") >= 0)
-		cli_message(gatoms[GOOMWWM_RESTART], argv[0]);
+		status |= cli_send(fd, GOOMWWM_RESTART, argv[0]);
+
+	if (find_arg(argc, argv, "-reload") >= 0)
+		status |= cli_send(fd, GOOMWWM_RELOAD, NULL);
 
 	if ((arg = find_arg_str(argc, argv, "-exec", NULL)))
-		cli_message(gatoms[GOOMWWM_RESTART], arg);
+		status |= cli_send(fd, GOOMWWM_EXEC, arg);
 
 	if ((arg = find_arg_str(argc, argv, "-ruleset", NULL)))
-		cli_message(gatoms[GOOMWWM_RULESET], arg);
+		status |= cli_send(fd, GOOMWWM_RULESET, arg);
 
 	if ((arg = find_arg_str(argc, argv, "-rule", NULL)))
-		cli_message(gatoms[GOOMWWM_RULE], arg);
+		status |= cli_send(fd, GOOMWWM_RULE, arg);
 
 	if ((arg = find_arg_str(argc, argv, "-findstart", NULL)))
-		cli_message(gatoms[GOOMWWM_FIND_OR_START], arg);
+		status |= cli_send(fd, GOOMWWM_FIND_OR_START, arg);
 
 	if (find_arg(argc, argv, "-quit") >= 0)
-		cli_message(gatoms[GOOMWWM_QUIT], NULL);
+		status |= cli_send(fd, GOOMWWM_QUIT, NULL);
 
 	if ((arg = find_arg_str(argc, argv, "-notice", NULL)))
 	{
@@ -64,10 +167,21 @@ int cli_main(int argc, char *argv[])
 		// bit of a hack for v1... write delay inline
 		char *tmp = alloca(strlen(arg) + 10);
 		sprintf(tmp, "%d %s", delay, arg);
-		cli_message(gatoms[GOOMWWM_NOTICE], tmp);
+		status |= cli_send(fd, GOOMWWM_NOTICE, tmp);
 	}
 
-	//TODO: make this a two-way event exchange
+	if (find_arg(argc, argv, "-stats") >= 0)
+		status |= cli_query(fd, GOOMWWM_STATS);
+
+	if (find_arg(argc, argv, "-resources") >= 0)
+		status |= cli_query(fd, GOOMWWM_RESOURCES);
+
+	if (fd >= 0)
+	{
+		close(fd);
+		return status ? EXIT_FAILURE: EXIT_SUCCESS;
+	}
+	// X messages are fire and forget. give goomwwm time to read them before our window goes away
 	usleep(500000); // 0.5s
-	return EXIT_SUCCESS;
-}
\ No newline at end of file
+	return status ? EXIT_FAILURE: EXIT_SUCCESS;
+}
@@ -26,39 +26,56 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 // manipulate client _NET_WM_STATE_*
 
+// a _NET_WM_STATE_* atom as its bit in client->state. 0 for states we don't track
+unsigned short client_state_bit(Atom state)
+{
+	int i; for (i = 0; i < CLIENTSTATE; i++) if (netatoms[_NET_WM_STATE_MODAL+i] == state) return 1<<i;
+	return 0;
+}
+
+// expand state bits to atoms. atoms must hold CLIENTSTATE
+int client_state_atoms(unsigned short state, Atom *atoms)
+{
+	int i, n = 0; for (i = 0; i < CLIENTSTATE; i++) if (state & (1<<i)) atoms[n++] = netatoms[_NET_WM_STATE_MODAL+i];
+	return n;
+}
+
 void client_flush_state(client *c)
 {
-	window_set_atom_prop(c->window, netatoms[_NET_WM_STATE], c->state, c->states);
+	Atom state[CLIENTSTATE]; int n = client_state_atoms(c->state, state);
+	window_set_atom_prop(c->window, netatoms[_NET_WM_STATE], state, n);
 }
 
 int client_has_state(client *c, Atom state)
 {
-	int i; for (i = 0; i < c->states; i++) if (c->state[i] == state) return 1;
-	return 0;
+	return c->state & client_state_bit(state) ?1:0;
+}
+
+// add a state without writing _NET_WM_STATE. returns 1 if it was added
+int client_stage_state(client *c, Atom state)
+{
+	unsigned short bit = client_state_bit(state);
+	if (!bit || c->state & bit) return 0;
+	c->state |= bit;
+	return 1;
 }
 
 void client_add_state(client *c, Atom state)
 {
-	if (c->states < CLIENTSTATE && !client_has_state(c, state))
-	{
-		c->state[c->states++] = state;
+	if (client_stage_state(c, state))
 		client_flush_state(c);
-	}
 }
 
 void client_remove_state(client *c, Atom state)
 {
 	if (!client_has_state(c, state)) return;
-	Atom newstate[CLIENTSTATE]; int i, n;
-	for (i = 0, n = 0; i < c->states; i++) if (c->state[i] != state) newstate[n++] = c->state[i];
-	memmove(c->state, newstate, sizeof(Atom)*n); c->states = n;
+	c->state &= ~client_state_bit(state);
 	client_flush_state(c);
 }
 
 void client_remove_all_states(client *c)
 {
-	memset(&c->state, 0, sizeof(Atom)*CLIENTSTATE);
-	c->states = 0; client_flush_state(c);
+	c->state = 0; client_flush_state(c);
 }
 
 void client_set_state(client *c, Atom state, int on)
@@ -66,30 +83,63 @@ void client_set_state(client *c, Atom state, int on)
 	if (on) client_add_state(c, state); else client_remove_state(c, state);
 }
 
-// extend client data
+// extend client data. the strings are fetched once per window and kept interned in
+// its wincache until handle_propertynotify() drops them, so this is usually free
 void client_descriptive_data(client *c)
 {
 	if (!c || c->is_described) return;
+	wincache *cache = c->cache;
 
-	char *name;
-	if ((name = window_get_text_prop(c->window, netatoms[_NET_WM_NAME])) && name)
-		c->title = name;
-	else
-	if (XFetchName(display, c->window, &name))
+	if (!(cache->described & DESCRIBED_TITLE))
 	{
-		c->title = strdup(name);
-		XFree(name);
+		char *name;
+		if ((name = window_get_text_prop(c->window, netatoms[_NET_WM_NAME])))
+		{
+			cache->wm_title = intern(name);
+			free(name);
+		}
+		else
+		if (XFetchName(display, c->window, &name))
+		{
+			cache->wm_title = intern(name);
+			XFree(name);
+		}
+		cache->described |= DESCRIBED_TITLE;
 	}
-	XClassHint chint;
-	if (XGetClassHint(display, c->window, &chint))
+	if (!(cache->described & DESCRIBED_CLASS))
 	{
-		c->class = strdup(chint.res_class);
-		c->name  = strdup(chint.res_name);
-		XFree(chint.res_class); XFree(chint.res_name);
+		XClassHint chint;
+		if (XGetClassHint(display, c->window, &chint))
+		{
+			cache->wm_class = intern(chint.res_class);
+			cache->wm_name  = intern(chint.res_name);
+			XFree(chint.res_class); XFree(chint.res_name);
+		}
+		cache->described |= DESCRIBED_CLASS;
 	}
+	if (cache->wm_title) c->title = cache->wm_title;
+	if (cache->wm_class) c->class = cache->wm_class;
+	if (cache->wm_name)  c->name  = cache->wm_name;
 	c->is_described = 1;
 }
 
+// drop interned strings after a property change. the next client_descriptive_data() refetches
+void client_forget_strings(wincache *cache, unsigned char which)
+{
+	if (which & DESCRIBED_TITLE)
+	{
+		intern_release(cache->wm_title);
+		cache->wm_title = NULL;
+	}
+	if (which & DESCRIBED_CLASS)
+	{
+		intern_release(cache->wm_class);
+		intern_release(cache->wm_name);
+		cache->wm_class = cache->wm_name = NULL;
+	}
+	cache->described &= ~which;
+}
+
 // extend client data
 // necessary for anything that is going to move/resize/stack, but expensive to do
 // every time in client_create()
@@ -97,7 +147,8 @@ void client_extended_data(client *c)
 {
 	if (!c || c->is_extended) return;
 
-	long sr; XGetWMNormalHints(display, c->window, &c->xsize, &sr);
+	c->xsize = arena_alloc_clear(&client_arena, sizeof(XSizeHints));
+	long sr; XGetWMNormalHints(display, c->window, c->xsize, &sr);
 	monitor_dimensions_struts(c->x+c->w/2, c->y+c->h/2, &c->monitor);
 
 	int screen_x = c->monitor.x, screen_y = c->monitor.y;
@@ -129,6 +180,17 @@ void client_extended_data(client *c)
 	c->is_extended = 1;
 }
 
+// match one rule pattern against a string, trying the cheap checks first
+int client_rule_string(winrule *r, char *str)
+{
+	if (r->literal) return strcasestr(str, r->literal) ?1:0;
+	if (r->prefilter && !strcasestr(str, r->prefilter)) return 0;
+	double start = timestamp();
+	int match = regexec(&r->re, str, 0, NULL, 0) ?0:1;
+	r->regex_time += timestamp() - start;
+	return match;
+}
+
 // true if a client window matches a rule pattern
 int client_rule_match(client *c, winrule *r)
 {
@@ -147,13 +209,14 @@ int client_rule_match(client *c, winrule *r)
 		// _NET_WM_WINDOW_TYPE_SPLASH can be annoying, so we do let them be ruled
 		// _NET_WM_WINDOW_TYPE_UTILITY and TOOLBAR are both persistent and may be managed and ruled
 	client_descriptive_data(c);
-	if (strchr(r->pattern, ':') && strchr("cnte", r->pattern[0]))
+	r->attempts++;
+	if (r->field)
 	{
-		if (r->pattern[0] == 'c') return regexec(&r->re, c->class, 0, NULL, 0) ?0:1;
-		if (r->pattern[0] == 'n') return regexec(&r->re, c->name,  0, NULL, 0) ?0:1;
-		if (r->pattern[0] == 't') return regexec(&r->re, c->title, 0, NULL, 0) ?0:1;
+		if (r->field == 'c') return client_rule_string(r, c->class);
+		if (r->field == 'n') return client_rule_string(r, c->name);
+		if (r->field == 't') return client_rule_string(r, c->title);
 		// check if window on edge:(top|left|bottom|right)
-		if (r->pattern[0] == 'e')
+		if (r->field == 'e')
 		{
 			client_extended_data(c);
 			char *p = strchr(r->pattern, ':')+1;
@@ -165,9 +228,9 @@ int client_rule_match(client *c, winrule *r)
 		return 0;
 	}
 	return (
-		regexec(&r->re, c->class, 0, NULL, 0) == 0 ||
-		regexec(&r->re, c->name,  0, NULL, 0) == 0 ||
-		regexec(&r->re, c->title, 0, NULL, 0) == 0) ?1:0;
+		client_rule_string(r, c->class) ||
+		client_rule_string(r, c->name)  ||
+		client_rule_string(r, c->title)) ?1:0;
 }
 
 // find a client's rule, optionally filtered by flags
@@ -175,12 +238,107 @@ winrule* client_rule(client *c, bitmap flags)
 {
 	if (!c->is_ruled)
 	{
-		c->rule = config_rules; while (c->rule && !client_rule_match(c, c->rule)) c->rule = c->rule->next;
+		wincache *cache = c->cache;
+		if (cache && cache->rule_gen == rule_generation && cache->rule_list == config_rules)
+			c->rule = cache->rule;
+		else
+		{
+			int edge = 0;
+			for (c->rule = config_rules; c->rule; c->rule = c->rule->next)
+			{
+				if (c->rule->field == 'e') edge = 1;
+				if (client_rule_match(c, c->rule)) { c->rule->hits++; break; }
+			}
+			// edge: matches depend on geometry, so can't be remembered
+			if (cache && !edge)
+			{
+				cache->rule = c->rule;
+				cache->rule_list = config_rules;
+				cache->rule_gen = rule_generation;
+			}
+		}
 		c->is_ruled = 1;
 	}
 	return (!c->rule || (flags && !(flags & c->rule->flags))) ? NULL: c->rule;
 }
 
+// create or drop a decorated client's titlebar to suit config_titlebar_height
+void client_review_title(client *c)
+{
+	if (!c->decorate || !c->cache->frame) return;
+	if (config_titlebar_height && !c->cache->title)
+	{
+		client_extended_data(c);
+		c->cache->title = textbox_create(c->cache->frame->window,
+			TB_CENTER, 0, c->border_width, c->w, config_titlebar_height,
+			config_titlebar_font, config_titlebar_focus, config_border_focus,
+			c->title, NULL);
+		XSelectInput(display, c->cache->title->window, ExposureMask);
+		textbox_show(c->cache->title);
+	}
+	else
+	if (!config_titlebar_height && c->cache->title)
+	{
+		textbox_free(c->cache->title);
+		c->cache->title = NULL;
+	}
+}
+
+// give a decorated client its frame and titlebar, recycled from frame_pool if possible.
+// done on first map, so windows that are only looked at never cost an X window
+void client_decorate(client *c)
+{
+	if (!c->decorate || c->cache->frame) return;
+
+	if (frame_pooled)
+	{
+		winframe *f = &frame_pool[--frame_pooled];
+		c->cache->frame = f->frame;
+		c->cache->title = f->title;
+		box_moveresize(c->cache->frame, c->x, c->y, c->w, c->h);
+		box_color(c->cache->frame, config_border_blur);
+	}
+	else
+	{
+		c->cache->frame = box_create(root, 0, c->x, c->y, c->w, c->h, config_border_blur);
+		window_set_ours(c->cache->frame->window);
+		XSelectInput(display, c->cache->frame->window, ExposureMask);
+	}
+	// associate with the window (see handle_buttonpress)
+	int idx = winlist_find(windows, c->cache->frame->window);
+	if (idx >= 0) ((wincache*)windows->data[idx])->app = c->window;
+
+	// stack frame under client window
+	Window wins[2] = { c->window, c->cache->frame->window };
+	XRestackWindows(display, wins, 2);
+
+	// ...and same for titlebar
+	client_review_title(c);
+}
+
+// hand a destroyed window's frame and titlebar back to frame_pool, or free them if it's full
+void client_undecorate(wincache *cache)
+{
+	if (!cache->frame) return;
+	box_hide(cache->frame);
+	int idx = winlist_find(windows, cache->frame->window);
+	if (idx >= 0) ((wincache*)windows->data[idx])->app = None;
+
+	if (frame_pooled < FRAMEPOOL)
+	{
+		winframe *f = &frame_pool[frame_pooled++];
+		f->frame = cache->frame;
+		f->title = cache->title;
+	}
+	else
+	{
+		if (cache->title) textbox_free(cache->title);
+		box_free(cache->frame);
+	}
+	cache->frame = NULL;
+	cache->title = NULL;
+}
+
 // collect info on any window
 // doesn't have to be a window we'll end up managing
 client* client_create(Window win)
@@ -193,11 +351,18 @@ client* client_create(Window win)
 	XWindowAttributes *attr = window_get_attributes(win);
 	if (!attr) return NULL;
 
-	client *c = allocate_clear(sizeof(client));
+	client *c = arena_alloc_clear(&client_arena, sizeof(client));
 	c->window = win; c->title = c->name = c->class = empty;
+	c->xsize = &no_size_hints;
 	// copy xattr so we don't have to care when stuff is freed
-	memmove(&c->xattr, attr, sizeof(XWindowAttributes));
-	XGetTransientForHint(display, win, &c->trans);
+	c->xattr.x = attr->x; c->xattr.y = attr->y;
+	c->xattr.width = attr->width; c->xattr.height = attr->height;
+	c->xattr.border_width = attr->border_width;
+	c->xattr.map_state = attr->map_state;
+	c->xattr.override_redirect = attr->override_redirect ?1:0;
+	Atom type; int items;
+	if (!window_get_prop(win, XA_WM_TRANSIENT_FOR, &type, &items, &c->trans, sizeof(Window)) || type != XA_WINDOW || !items)
+		c->trans = None;
 
 	// find last known state
 	wincache *cache = NULL;
@@ -214,7 +379,9 @@ client* client_create(Window win)
 	c->cache = windows->data[idx];
 
 	c->visible = c->xattr.map_state == IsViewable ?1:0;
-	c->states  = window_get_atom_prop(win, netatoms[_NET_WM_STATE], c->state, CLIENTSTATE);
+	Atom state[CLIENTSTATE*2];
+	int states = window_get_atom_prop(win, netatoms[_NET_WM_STATE], state, CLIENTSTATE*2);
+	while (states > 0) c->state |= client_state_bit(state[--states]);
 	window_get_atom_prop(win, netatoms[_NET_WM_WINDOW_TYPE], &c->type, 1);
 
 	if (c->type == None) c->type = (c->trans != None)
@@ -240,17 +407,16 @@ client* client_create(Window win)
 
 	// focus seems a really dodgy way to determine the "active" window, but in some
 	// cases checking both ->active and ->focus is necessary to bahave logically
-	Window focus; int rev;
-	XGetInputFocus(display, &focus, &rev);
-	c->focus = focus == win ? 1:0;
+	c->focus = window_focus() == win ? 1:0;
 
-	XWMHints *hints = XGetWMHints(display, win);
-	if (hints)
+	// WM_HINTS read raw, so startup can use prefetched values. see window_prefetch()
+	// flags, input, initial_state, ...
+	long hints[9];
+	if (window_get_prop(win, XA_WM_HINTS, &type, &items, hints, sizeof(hints)) && type == XA_WM_HINTS && items >= 3)
 	{
-		c->input = hints->flags & InputHint && hints->input ? 1: 0;
-		c->initial_state = hints->flags & StateHint ? hints->initial_state: NormalState;
-		c->urgent = c->urgent || hints->flags & XUrgencyHint ? 1: 0;
-		XFree(hints);
+		c->input = hints[0] & InputHint && hints[1] ? 1: 0;
+		c->initial_state = hints[0] & StateHint ? hints[2]: NormalState;
+		c->urgent = c->urgent || hints[0] & XUrgencyHint ? 1: 0;
 	}
 
 	c->decorate = c->manage;
@@ -271,36 +437,7 @@ client* client_create(Window win)
 		c->w += c->border_width*2;
 		c->h += c->border_width*2 + c->titlebar_height;
 	}
-	// check whether the frame should be created
-	if (c->decorate && !c->cache->frame)
-	{
-		c->cache->frame = box_create(root, 0, c->x, c->y, c->w, c->h, config_border_blur);
-
-		cache = allocate_clear(sizeof(wincache));
-		winlist_append(windows, c->cache->frame->window, cache);
-		cache->is_ours = 1;
-		// associate with the window (see handle_buttonpress)
-		cache->app = c->window;
-
-		XSelectInput(display, c->cache->frame->window, ExposureMask);
-
-		// stack frame under client window
-		Window wins[2] = { c->window, c->cache->frame->window };
-		XRestackWindows(display, wins, 2);
-
-		// ...and same for titlebar
-		if (config_titlebar_height)
-		{
-			client_extended_data(c);
-			c->cache->title = textbox_create(c->cache->frame->window,
-				TB_CENTER, 0, c->border_width, c->w, config_titlebar_height,
-				config_titlebar_font, config_titlebar_focus, config_border_focus,
-				c->title, NULL);
-			XSelectInput(display, c->cache->title->window, ExposureMask);
-			textbox_show(c->cache->title);
-		}
-	}
-
+	// frames are created when first mapped. see client_decorate()
 	winlist_append(cache_client, c->window, c);
 	return c;
 }
@@ -308,26 +445,16 @@ client* client_create(Window win)
 // refresh client_cache
 client* client_recreate(Window w)
 {
+	// the old record stays in client_arena until the next reset_cache_client()
 	int idx = winlist_find(cache_client, w);
 	if (idx >= 0)
 	{
-		client_free(cache_client->data[idx]);
 		cache_client->data[idx] = NULL;
 		winlist_forget(cache_client, w);
 	}
 	return client_create(w);
 }
 
-// release client memory. this should only be called during the global cache resets
-void client_free(client *c)
-{
-	if (!c) return;
-	if (c->title != empty) free(c->title);
-	if (c->class != empty) free(c->class);
-	if (c->name  != empty) free(c->name);
-	free(c);
-}
-
 // true if client windows overlap
 int clients_intersect(client *a, client *b)
 {
@@ -414,41 +541,41 @@ void client_process_size_hints(client *c, int *x, int *y, int *w, int *h)
 	int dec_w = c->border_width*2, dec_h = c->border_width*2+c->titlebar_height;
 	int basew = 0, baseh = 0;
 
-	if (c->xsize.flags & PBaseSize)
+	if (c->xsize->flags & PBaseSize)
 	{
-		basew = c->xsize.base_width;
-		baseh = c->xsize.base_height;
+		basew = c->xsize->base_width;
+		baseh = c->xsize->base_height;
 	}
-	if (c->xsize.flags & PMinSize)
+	if (c->xsize->flags & PMinSize)
 	{
 		// fw/fh still include borders here
-		fw = MAX(fw, c->xsize.min_width  + dec_w);
-		fh = MAX(fh, c->xsize.min_height + dec_h);
+		fw = MAX(fw, c->xsize->min_width  + dec_w);
+		fh = MAX(fh, c->xsize->min_height + dec_h);
 	}
-	if (c->xsize.flags & PMaxSize)
+	if (c->xsize->flags & PMaxSize)
 	{
 		// fw/fh still include borders here
-		fw = MIN(fw, c->xsize.max_width  + dec_w);
-		fh = MIN(fh, c->xsize.max_height + dec_h);
+		fw = MIN(fw, c->xsize->max_width  + dec_w);
+		fh = MIN(fh, c->xsize->max_height + dec_h);
 	}
-	if (config_resize_inc && c->xsize.flags & PResizeInc)
+	if (config_resize_inc && c->xsize->flags & PResizeInc)
 	{
 		client_descriptive_data(c);
 		if (config_resize_inc == RESIZEINC
-			|| (config_resize_inc == SMARTRESIZEINC && !regquick(SMARTRESIZEINC_IGNORE, c->class)))
+			|| (config_resize_inc == SMARTRESIZEINC && regexec(&config_resizeinc_re, c->class, 0, NULL, 0) != 0))
 		{
 			// fw/fh still include borders here
 			fw -= basew + dec_w; fh -= baseh + dec_h;
-			fw -= fw % c->xsize.width_inc;
-			fh -= fh % c->xsize.height_inc;
+			fw -= fw % c->xsize->width_inc;
+			fh -= fh % c->xsize->height_inc;
 			fw += basew + dec_w; fh += baseh + dec_h;
 		}
 	}
-	if (c->xsize.flags & PAspect)
+	if (c->xsize->flags & PAspect)
 	{
 		double ratio = (double) fw / fh;
-		double minr  = (double) c->xsize.min_aspect.x / c->xsize.min_aspect.y;
-		double maxr  = (double) c->xsize.max_aspect.x / c->xsize.max_aspect.y;
+		double minr  = (double) c->xsize->min_aspect.x / c->xsize->min_aspect.y;
+		double maxr  = (double) c->xsize->max_aspect.x / c->xsize->max_aspect.y;
 			if (ratio < minr) fh = (int)(fw / minr);
 		else if (ratio > maxr) fw = (int)(fh * maxr);
 	}
@@ -604,58 +731,73 @@ void client_moveresize(client *c, unsigned int flags, int fx, int fy, int fw, in
 		fw = MAX(1, fw - c->border_width*2);
 		fh = MAX(1, fh - c->border_width*2 - c->titlebar_height);
 	}
-	if (c->decorate) box_moveresize(c->cache->frame, c->x, c->y, c->w, c->h);
+	if (c->cache->frame) box_moveresize(c->cache->frame, c->x, c->y, c->w, c->h);
 	XMoveResizeWindow(display, c->window, fx, fy, fw, fh);
 	client_redecorate(c);
 }
 
-// record a window's size and position in the undo log
-void client_commit(client *c)
+// start grouping client_commit()s into one undo step, so client_undo() on any
+// window involved rolls back all of them. nests
+void undo_begin()
 {
-	client_extended_data(c);
-	int levels = 0; winundo *undo = c->cache->undo;
-	// count current undo chain length for this window
-	while (undo) { levels++; undo = undo->next; }
+	if (undo_nest++) return;
+	if (!++undo_txns) undo_txns++;
+	undo_txn = undo_txns;
+}
 
-	if (levels > 0)
-	{
-		// check if the most recent undo state matches current state. if so, no point recording
-		undo = c->cache->undo;
-		if (undo->x == c->x && undo->y == c->y && undo->w == c->w && undo->h == c->h) return;
-	}
-	// LIFO up to UNDO cells deep
-	if (levels == UNDO)
-	{
-		undo = c->cache->undo;
-		// find second last link
-		while (undo->next && undo->next->next) undo = undo->next;
-		// chop of the last link
-		free(undo->next); undo->next = NULL;
-	}
-	undo = allocate_clear(sizeof(winundo));
-	undo->next = c->cache->undo; c->cache->undo = undo;
+void undo_end()
+{
+	if (undo_nest > 0 && !--undo_nest) undo_txn = 0;
+}
+
+// record a window's size and position in the undo log. true if a cell was added.
+// inside undo_begin() a window gets one cell per step, holding where it started
+int client_commit(client *c)
+{
+	client_extended_data(c);
+	winundo *undo = winring_top(&c->cache->undo);
+	if (undo_txn && undo && undo->txn == undo_txn) return 0;
+	// check if the most recent undo state matches current state. if so, no point recording.
+	// inside a step it is recorded anyway, so this window joins the step
+	if (!undo_txn && undo && undo->x == c->x && undo->y == c->y && undo->w == c->w && undo->h == c->h) return 0;
+	// LIFO up to config_undo cells deep
+	undo = winring_push(&c->cache->undo, config_undo);
 	// do the actual snapshot
 	undo->x = c->x; undo->y = c->y; undo->w = c->w; undo->h = c->h;
-	for (undo->states = 0; undo->states < c->states; undo->states++)
-		undo->state[undo->states] = c->state[undo->states];
+	undo->state = c->state;
+	undo->txn = undo_txn;
+	return 1;
 }
 
 // move/resize a window back to it's last known size and position
 void client_rollback(client *c)
 {
-	if (c->cache->undo)
+	winundo *top = winring_pop(&c->cache->undo);
+	if (top)
 	{
-		// remove most recent winundo from the undo chain
-		winundo *undo = c->cache->undo; c->cache->undo = undo->next;
+		// the cell is reused by the next push
+		winundo undo = *top;
 		// do the actual rollback
-		for (c->states = 0; c->states < undo->states; c->states++)
-			c->state[c->states] = undo->state[c->states];
+		c->state = undo.state;
 		client_flush_state(c);
-		client_moveresize(c, 0, undo->x, undo->y, undo->w, undo->h);
-		free(undo);
+		client_moveresize(c, 0, undo.x, undo.y, undo.w, undo.h);
 	}
 }
 
+// user undo. rolls back every window in the same multi-window step
+void client_undo(client *c)
+{
+	winundo *undo = winring_top(&c->cache->undo);
+	if (!undo) return;
+	unsigned int txn = undo->txn;
+	if (!txn) { client_rollback(c); return; }
+
+	int i; Window w; client *o;
+	managed_ascend(i, w, o)
+		if ((undo = winring_top(&o->cache->undo)) && undo->txn == txn)
+			client_rollback(o);
+}
+
 // save co-ords for later flip-back
 // these may MAY BE dulicated in the undo log, but they must remain separate
 // to allow proper toggle behaviour for maxv/maxh
@@ -723,7 +865,7 @@ void client_restore_position_vert(client *c, unsigned int smart, int y, int h)
 }
 
 // build list of unobscured windows within a workarea
-winlist* clients_fully_visible(workarea *zone, unsigned int tag, Window ignore)
+winlist* clients_fully_visible(workarea *zone, bitmap tag, Window ignore)
 {
 	winlist *hits = winlist_new();
 	winlist *inplay = windows_in_play();
@@ -759,7 +901,7 @@ winlist* clients_fully_visible(workarea *zone, unsigned int tag, Window ignore)
 }
 
 // build list of unobscured windows within a workarea
-winlist* clients_partly_visible(workarea *zone, unsigned int tag, Window ignore)
+winlist* clients_partly_visible(workarea *zone, bitmap tag, Window ignore)
 {
 	winlist *hits = winlist_new();
 	winlist *inplay = windows_in_play();
@@ -864,8 +1006,8 @@ void client_expand(client *c, int directions, int x1, int y1, int w1, int h1, in
 	client_moveresize(c, 0, x, y, w, h);
 	// if we looked like we could expand, but couldn't due to some condition in client_moveresize(),
 	// act like a toggle and rollback instead
-	winundo *undo = c->cache->undo;
-	if (undo->x == c->x && undo->y == c->y && undo->w == c->w && undo->h == c->h)
+	winundo *undo = winring_top(&c->cache->undo);
+	if (undo && undo->x == c->x && undo->y == c->y && undo->w == c->w && undo->h == c->h)
 	{
 		// yes, twice!
 		client_rollback(c);
@@ -1019,42 +1161,14 @@ void client_toggle_large(client *c, int side)
 // for now, four coloured squares in the corners. could get fancier?
 void client_flash(client *c, char *color, int delay, int title)
 {
-	XSync(display, False);
-	if (!fork())
-	{
-		Window win = c->window;
-		display = XOpenDisplay(0x0);
-		reset_cache_xattr();
-		reset_cache_client();
-		reset_cache_inplay();
-
-		c = client_create(win);
-		if (!c) exit(EXIT_FAILURE);
-		client_descriptive_data(c);
-		client_extended_data(c);
-
-		int x1 = c->x, x2 = c->x + c->w - config_flash_width;
-		int y1 = c->y, y2 = c->y + c->h - config_flash_width;
-
-		// use message_box for title
-		if (title || config_flash_title)
-			message_box(delay, c->x+c->w/2, c->y+c->h/2, config_title_fg, config_title_bg, config_title_bc, c->title);
-
-		// four coloured squares in the window's corners
-		box *tl = box_create(root, BOX_OVERRIDE, x1, y1, config_flash_width, config_flash_width, color);
-		box *tr = box_create(root, BOX_OVERRIDE, x2, y1, config_flash_width, config_flash_width, color);
-		box *bl = box_create(root, BOX_OVERRIDE, x1, y2, config_flash_width, config_flash_width, color);
-		box *br = box_create(root, BOX_OVERRIDE, x2, y2, config_flash_width, config_flash_width, color);
-
-		box_show(tl); box_show(tr); box_show(bl); box_show(br);
-
-		XSync(display, False);
-		usleep(delay*1000);
+	client_descriptive_data(c);
+	client_extended_data(c);
 
-		box_free(tl); box_free(tr); box_free(bl); box_free(br);
+	// title shown as a notice over the window. keyed to the window so repeat flashes replace it
+	if (title || config_flash_title)
+		notice_show(c->window, delay, c->x+c->w/2, c->y+c->h/2, c->title);
 
-		exit(EXIT_SUCCESS);
-	}
+	flash_show(c->window, c->x, c->y, c->w, c->h, color, delay);
 }
 
 // add a window and family to the stacking order
@@ -1077,7 +1191,7 @@ void client_stack_family(client *c, winlist *stack)
 	// move this window to end (bottom) of stack
 	winlist_forget(stack, c->window);
 	winlist_append(stack, c->window, NULL);
-	if (c->decorate) winlist_append(stack, c->cache->frame->window, NULL);
+	if (c->cache->frame) winlist_append(stack, c->cache->frame->window, NULL);
 }
 
 // raise a window and its transients
@@ -1165,6 +1279,7 @@ void client_lower(client *c, int priority)
 void client_review_border(client *c)
 {
 	client_extended_data(c);
+	client_decorate(c);
 	XSetWindowBorderWidth(display, c->window, 0);
 	unsigned long extents[4] = { c->border_width, c->border_width, c->border_width + c->titlebar_height, c->border_width };
 
@@ -1174,7 +1289,7 @@ void client_review_border(client *c)
 		memset(extents, 0, sizeof(extents));
 	}
 	else
-	if (c->decorate)
+	if (c->cache->frame)
 	{
 		Window wins[2] = { c->window, c->cache->frame->window };
 		XRestackWindows(display, wins, 2);
@@ -1231,7 +1346,7 @@ void client_review_position(client *c)
 // check a window's _NET_WM_DESKTOP. if found, tag it appropriately
 void client_review_desktop(client *c)
 {
-	unsigned long d;
+	unsigned long d; bitmap old = c->cache->tags;
 	// no desktop set. give it one
 	if (!window_get_cardinal_prop(c->window, netatoms[_NET_WM_DESKTOP], &d, 1))
 	{
@@ -1240,11 +1355,12 @@ void client_review_desktop(client *c)
 	}
 	else
 	// window has a desktop set. convert it to tag
-	if (d < TAGS)
+	if (d < config_tags)
 		c->cache->tags |= desktop_to_tag(d);
 	else
 	if (d == 0xffffffff)
 		c->cache->tags = 0;
+	tag_members_update(c->window, old, c->cache->tags);
 }
 
 // if client is new or has changed state since we last looked, tweak stuff
@@ -1259,7 +1375,7 @@ void client_full_review(client *c)
 // configure a client's frame color
 void client_redecorate(client *c)
 {
-	if (!c->decorate) return;
+	if (!c->cache->frame) return;
 
 	char *border = config_border_blur;
 	if (c->urgent) border = config_border_attention;
@@ -1268,7 +1384,7 @@ void client_redecorate(client *c)
 	box_color(c->cache->frame, border);
 	box_draw(c->cache->frame);
 
-	if (!c->titlebar_height) return;
+	if (!c->titlebar_height || !c->cache->title) return;
 	client_descriptive_data(c);
 
 	textbox_text(c->cache->title, c->title);
@@ -1313,14 +1429,15 @@ void client_activate(client *c, int raise, int warp)
 {
 	int i; Window w; client *o;
 
-	// deactivate everyone else
-	clients_ascend(windows_in_play(), i, w, o) if (w != c->window) client_deactivate(o, c);
+	// deactivate whoever had focus. nobody else is drawn active
+	clients_ascend(windows_in_play(), i, w, o)
+		if (w != c->window && (o->active || o->focus)) client_deactivate(o, c);
 
 	if (c->minimized) client_restore(c);
 	if (c->shaded) client_reveal(c);
 
 	// setup ourself
-	if (config_raise_mode == RAISEFOCUS || raise)
+	if (raise != NORAISE && (config_raise_mode == RAISEFOCUS || raise))
 		client_raise(c, client_has_state(c, netatoms[_NET_WM_STATE_FULLSCREEN]));
 
 	// focus a window politely if possible
@@ -1348,12 +1465,16 @@ void client_activate(client *c, int raise, int warp)
 
 	// set focus border color
 	client_redecorate(c);
+
+	// -monitortags: the tag follows focus between monitors
+	monitor_follow(c);
 }
 
 // set WM_STATE
 void client_set_wm_state(client *c, unsigned long state)
 {
 	unsigned long payload[] = { state, None };
+	window_prefetch_forget(c->window);
 	XChangeProperty(display, c->window, atoms[WM_STATE], atoms[WM_STATE], 32, PropModeReplace, (unsigned char*)payload, 2);
 }
 
@@ -1364,7 +1485,7 @@ unsigned long client_get_wm_state(client *c)
 }
 
 // locate the currently focused window and build a client for it
-client* client_active(unsigned int tag)
+client* client_active(bitmap tag)
 {
 	int i; Window w; client *c = NULL, *o;
 	// look for a visible, previously activated window in the current tag
@@ -1641,12 +1762,14 @@ void client_htile(client *c)
 	if (tiles->len > 1)
 	{
 		int width = c->w / tiles->len;
+		undo_begin();
 		clients_ascend(tiles, i, w, o)
 		{
 			client_commit(o);
 			client_remove_state(o, netatoms[_NET_WM_STATE_MAXIMIZED_HORZ]);
 			client_moveresize(o, 0, c->x+(width*i), c->y, width, c->h);
 		}
+		undo_end();
 	}
 	winlist_free(tiles);
 }
@@ -1666,12 +1789,14 @@ void client_huntile(client *c)
 			min_x = MIN(min_x, o->x);
 			max_x = MAX(max_x, o->x+o->w);
 		}
+		undo_begin();
 		clients_ascend(tiles, i, w, o)
 		{
 			client_commit(o);
 			client_remove_state(o, netatoms[_NET_WM_STATE_MAXIMIZED_HORZ]);
 			client_moveresize(o, 0, min_x, c->y, max_x-min_x, c->h);
 		}
+		undo_end();
 	}
 	winlist_free(tiles);
 }
@@ -1690,12 +1815,14 @@ void client_vtile(client *c)
 	if (tiles->len > 1)
 	{
 		int height = c->h / tiles->len;
+		undo_begin();
 		clients_ascend(tiles, i, w, o)
 		{
 			client_commit(o);
 			client_remove_state(o, netatoms[_NET_WM_STATE_MAXIMIZED_VERT]);
 			client_moveresize(o, 0, c->x, c->y+(height*i), c->w, height);
 		}
+		undo_end();
 	}
 	winlist_free(tiles);
 }
@@ -1715,12 +1842,14 @@ void client_vuntile(client *c)
 			min_y = MIN(min_y, o->y);
 			max_y = MAX(max_y, o->y+o->h);
 		}
+		undo_begin();
 		clients_ascend(tiles, i, w, o)
 		{
 			client_commit(o);
 			client_remove_state(o, netatoms[_NET_WM_STATE_MAXIMIZED_HORZ]);
 			client_moveresize(o, 0, c->x, min_y, c->w, max_y-min_y);
 		}
+		undo_end();
 	}
 	winlist_free(tiles);
 }
@@ -1792,14 +1921,13 @@ void client_swapto(client *c, int direction)
 		if (((direction == FOCUSLEFT || direction == FOCUSRIGHT) && overlap_x) ||
 			((direction == FOCUSUP  || direction == FOCUSDOWN ) && overlap_y))
 		{
+			undo_begin();
 			client_commit(c); client_commit(m);
+			undo_end();
 
 			// swap EWMH states
-			Atom state[CLIENTSTATE]; int states = c->states;
-			memmove(&state, c->state,     sizeof(state));
-			memmove(&c->state, &m->state, sizeof(state));
-			memmove(&m->state, &state,    sizeof(state));
-			c->states = m->states; m->states = states;
+			unsigned short state = c->state;
+			c->state = m->state; m->state = state;
 			client_flush_state(c); client_flush_state(m);
 
 			// swap positions
@@ -1836,7 +1964,7 @@ void client_duplicate(client *c)
 void client_minimize(client *c)
 {
 	XUnmapWindow(display, c->window);
-	if (c->decorate) box_show(c->cache->frame);
+	if (c->cache->frame) box_show(c->cache->frame);
 	// no update fo windows_activated yet. see handle_unmapnotify()
 	winlist_forget(windows_minimized, c->window);
 	winlist_append(windows_minimized, c->window, NULL);
@@ -1853,7 +1981,7 @@ void client_minimize(client *c)
 void client_restore(client *c)
 {
 	XMapWindow(display, c->window);
-	if (c->decorate) box_show(c->cache->frame);
+	if (c->cache->frame) box_show(c->cache->frame);
 	// no update fo windows_minimized yet. see handle_mapnotify()
 	winlist_forget(windows_activated, c->window);
 	winlist_prepend(windows_activated, c->window, NULL);
@@ -1868,7 +1996,7 @@ void client_restore(client *c)
 void client_shade(client *c)
 {
 	XUnmapWindow(display, c->window);
-	if (c->decorate) box_hide(c->cache->frame);
+	if (c->cache->frame) box_hide(c->cache->frame);
 	// no update fo windows_activated yet. see handle_unmapnotify()
 	winlist_forget(windows_shaded, c->window);
 	winlist_append(windows_shaded, c->window, NULL);
@@ -1892,8 +2020,22 @@ void client_reveal(client *c)
 		if (o->trans == c->window) client_restore(o);
 }
 
+// window switcher selection. ids is the switcher's window list
+void client_switcher_done(int line, char *text, void *data)
+{
+	winlist *ids = data; client *c;
+	if (line >= 0 && line < ids->len)
+	{
+		if ((c = client_create(ids->array[line])) && c->manage)
+			client_activate(c, RAISE, WARPDEF);
+	}
+	else
+	if (text) exec_cmd(text);
+	winlist_free(ids);
+}
+
 // built-in window switcher
-void client_switcher(unsigned int tag)
+void client_switcher(bitmap tag)
 {
 	// TODO: this whole function is messy. build a nicer solution
 	char pattern[50], **list = NULL;
@@ -1913,15 +2055,13 @@ void client_switcher(unsigned int tag)
 		{
 			if (c->manage && (c->visible || c->minimized || c->shaded) && !client_has_state(c, netatoms[_NET_WM_STATE_SKIP_TASKBAR]))
 			{
-				client_descriptive_data(c);
 				if (!tag || (c->cache && c->cache->tags & tag))
 				{
+					client_descriptive_data(c);
 					if (c->minimized) minimized = 1;
 					if (client_has_state(c, netatoms[_NET_WM_STATE_ABOVE])) above = 1;
 					if (client_has_state(c, netatoms[_NET_WM_STATE_STICKY])) sticky = 1;
-					int j, t; for (j = 0, t = 0; j < TAGS; j++)
-						if (c->cache->tags & (1<<j)) t++;
-					maxtags = MAX(maxtags, t);
+					maxtags = MAX(maxtags, __builtin_popcountll(c->cache->tags));
 					classfield = MAX(classfield, strlen(c->class));
 					winlist_append(ids, c->window, NULL);
 					lines++;
@@ -1942,9 +2082,9 @@ void client_switcher(unsigned int tag)
 		client_descriptive_data(c);
 		if (!tag || (c->cache && c->cache->tags & tag))
 		{
-			char tags[32]; memset(tags, 0, 32);
-			int j, l; for (l = 0, j = 0; j < TAGS; j++)
-				if (c->cache->tags & (1<<j)) l += sprintf(tags+l, "%d,", j+1);
+			char tags[TAGS*3+1]; memset(tags, 0, sizeof(tags));
+			int j, l = 0; bitmap m;
+			tag_bits(j, c->cache->tags, m) l += sprintf(tags+l, "%d,", j+1);
 			if (l > 0) tags[l-1] = '\0';
 
 			char aos[6]; memset(aos, 0, 6);
@@ -1962,26 +2102,13 @@ void client_switcher(unsigned int tag)
 			list[lines++] = line;
 		}
 	}
-	if (!fork())
-	{
-		display = XOpenDisplay(0);
-		XSync(display, True);
-		char *input = NULL;
-		int n = menu(list, &input, "> ", 1);
-		if (n >= 0 && list[n])
-			window_send_message(root, ids->array[n], netatoms[_NET_ACTIVE_WINDOW], 2, // 2 = pager
-				SubstructureNotifyMask | SubstructureRedirectMask);
-		else
-		if (input) exec_cmd(input);
-		exit(EXIT_SUCCESS);
-	}
-	for (i = 0; i < lines; i++) free(list[i]);
-	free(list); winlist_free(ids);
+	menu(list, "> ", 1, client_switcher_done, ids);
 }
 
 // toggle client in current tag
-void client_toggle_tag(client *c, unsigned int tag, int flash)
+void client_toggle_tag(client *c, bitmap tag, int flash)
 {
+	bitmap old = c->cache->tags;
 	if (c->cache->tags & tag)
 	{
 		c->cache->tags &= ~tag;
@@ -1991,6 +2118,7 @@ void client_toggle_tag(client *c, unsigned int tag, int flash)
 		c->cache->tags |= tag;
 		if (flash) client_flash(c, config_flash_on, config_flash_ms, FLASHTITLEDEF);
 	}
+	tag_members_update(c->window, old, c->cache->tags);
 	// update _NET_WM_DESKTOP using lowest tag number.
 	// this is a bit of a fudge as we can have windows on multiple
 	// tags/desktops, without being specifically sticky... oh well.
@@ -2004,10 +2132,10 @@ client* client_find(char *pattern)
 	if (!pattern) return None;
 	int i; Window w; client *c = NULL, *found = NULL;
 
-	// use a tempoarary rule for searching
-	rule_parse(pattern);
-	winrule *rule = config_rules;
-	config_rules = rule->next;
+	// use a temporary rule for searching. it never joins config_rules, so
+	// memoised rule matches stay valid
+	winrule *rule = rule_create(pattern);
+	if (!rule) return NULL;
 
 	// first, try in current_tag only
 	tag_descend(i, w, c, current_tag)
@@ -2027,7 +2155,7 @@ client* client_find(char *pattern)
 	if (!found) clients_descend(windows_shaded, i, w, c)
 		if (client_rule_match(c, rule)) { found = c; client_restore(c); break; }
 
-	rule_free(rule);
+	rule_release(rule);
 	return found;
 }
 
@@ -2039,44 +2167,51 @@ void client_start(char *pattern)
 	exec_cmd(pattern);
 }
 
-// search for and activate first open window matching class/name/title
-void client_find_or_start(char *pattern)
+// search for and activate first open window matching class/name/title. true if found
+int client_find_or_start(char *pattern)
 {
-	if (!pattern) return;
+	if (!pattern) return 0;
 	client *c = client_find(pattern);
 	if (c) client_switch_to(c);
 	else client_start(pattern);
+	return c ? 1: 0;
 }
 
 void client_rules_ewmh(client *c)
 {
-	// process EWMH rules
+	// process EWMH rules. states are staged and written once
+	unsigned short n = c->state;
 	// above below are mutally exclusize
-		if (client_rule(c, RULE_ABOVE)) client_add_state(c, netatoms[_NET_WM_STATE_ABOVE]);
-	else if (client_rule(c, RULE_BELOW)) client_add_state(c, netatoms[_NET_WM_STATE_BELOW]);
+		if (client_rule(c, RULE_ABOVE)) client_stage_state(c, netatoms[_NET_WM_STATE_ABOVE]);
+	else if (client_rule(c, RULE_BELOW)) client_stage_state(c, netatoms[_NET_WM_STATE_BELOW]);
 
 	// sticky,skip_taskbar,skip_pager can be on anything
-	if (client_rule(c, RULE_STICKY))   client_add_state(c, netatoms[_NET_WM_STATE_STICKY]);
-	if (client_rule(c, RULE_SKIPTBAR)) client_add_state(c, netatoms[_NET_WM_STATE_SKIP_TASKBAR]);
-	if (client_rule(c, RULE_SKIPPAGE)) client_add_state(c, netatoms[_NET_WM_STATE_SKIP_PAGER]);
+	if (client_rule(c, RULE_STICKY))   client_stage_state(c, netatoms[_NET_WM_STATE_STICKY]);
+	if (client_rule(c, RULE_SKIPTBAR)) client_stage_state(c, netatoms[_NET_WM_STATE_SKIP_TASKBAR]);
+	if (client_rule(c, RULE_SKIPPAGE)) client_stage_state(c, netatoms[_NET_WM_STATE_SKIP_PAGER]);
 
 	// fullscreen overrides max h/v
 	if (client_rule(c, RULE_FULLSCREEN))
-		client_add_state(c, netatoms[_NET_WM_STATE_FULLSCREEN]);
+		client_stage_state(c, netatoms[_NET_WM_STATE_FULLSCREEN]);
 	else
 	// max h/v overrides lock h/v
 	if (client_rule(c, RULE_MAXHORZ|RULE_MAXVERT))
 	{
-		if (client_rule(c, RULE_MAXHORZ)) client_add_state(c, netatoms[_NET_WM_STATE_MAXIMIZED_HORZ]);
-		if (client_rule(c, RULE_MAXVERT)) client_add_state(c, netatoms[_NET_WM_STATE_MAXIMIZED_VERT]);
+		if (client_rule(c, RULE_MAXHORZ)) client_stage_state(c, netatoms[_NET_WM_STATE_MAXIMIZED_HORZ]);
+		if (client_rule(c, RULE_MAXVERT)) client_stage_state(c, netatoms[_NET_WM_STATE_MAXIMIZED_VERT]);
 	}
+	if (c->state != n) client_flush_state(c);
 }
 
-void client_rules_monitor(client *c)
+// monitor, size and placement rules, resolved into a single client_moveresize()
+void client_rules_geometry(client *c)
 {
+	client_extended_data(c);
+	int mr = 0, center = 0;
+
+	// specifying a non-active monitor will center the window there
 	if (client_rule(c, RULE_MONITOR1|RULE_MONITOR2|RULE_MONITOR3))
 	{
-		client_extended_data(c);
 		XineramaScreenInfo *info; int monitors;
 		workarea mon; memset(&mon, 0, sizeof(workarea));
 		if ((info = XineramaQueryScreens(display, &monitors)))
@@ -2094,17 +2229,9 @@ void client_rules_monitor(client *c)
 		if (mon.w && (mon.x != c->monitor.x || mon.y != c->monitor.y))
 		{
 			memmove(&c->monitor, &mon, sizeof(workarea));
-			client_moveresize(c, 0, MAX(mon.x, mon.x + ((mon.w - c->w) / 2)),
-				MAX(mon.y, mon.y + ((mon.h - c->h) / 2)), c->w, c->h);
+			center = mr = 1;
 		}
 	}
-}
-
-void client_rules_moveresize(client *c)
-{
-	client_extended_data(c);
-	int mr = 0;
-
 	// if a size rule exists, apply it
 	if (client_rule(c, RULE_SMALL|RULE_MEDIUM|RULE_LARGE|RULE_COVER|RULE_SIZE))
 	{
@@ -2121,7 +2248,7 @@ void client_rules_moveresize(client *c)
 		mr = 1;
 	}
 	//  if a placement rule exists, it trumps everything
-	if (client_rule(c, RULE_TOP|RULE_LEFT|RULE_RIGHT|RULE_BOTTOM|RULE_CENTER|RULE_POINTER))
+	if (center || client_rule(c, RULE_TOP|RULE_LEFT|RULE_RIGHT|RULE_BOTTOM|RULE_CENTER|RULE_POINTER))
 	{
 		c->x = MAX(c->monitor.x, c->monitor.x + ((c->monitor.w - c->w) / 2));
 		c->y = MAX(c->monitor.y, c->monitor.y + ((c->monitor.h - c->h) / 2));
@@ -2160,55 +2287,75 @@ void client_rules_locks(client *c)
 // apply tags
 void client_rules_tags(client *c)
 {
-	if (client_rule(c, (TAG1|TAG2|TAG3|TAG4|TAG5|TAG6|TAG7|TAG8|TAG9)))
+	if (client_rule(c, RULE_TAGS))
 	{
-		c->cache->tags = 0;
-		client_toggle_tag(c, c->rule->flags & (TAG1|TAG2|TAG3|TAG4|TAG5|TAG6|TAG7|TAG8|TAG9), NOFLASH);
-	}
-}
-
-// post-placement rules
-void client_rules_moveresize_post(client *c)
-{
-	unsigned int tag = current_tag; current_tag = desktop_to_tag(tag_to_desktop(c->cache->tags));
-	if (client_rule(c, RULE_SNAPRIGHT)) client_snapto(c, SNAPRIGHT);
-	if (client_rule(c, RULE_SNAPLEFT))  client_snapto(c, SNAPLEFT);
-	if (client_rule(c, RULE_SNAPDOWN))  client_snapto(c, SNAPDOWN);
-	if (client_rule(c, RULE_SNAPUP))    client_snapto(c, SNAPUP);
-	// yes, can do both contract and expand in one rule. it makes sense...
-	if (client_rule(c, RULE_CONTRACT))  client_contract(c, HORIZONTAL|VERTICAL);
-	if (client_rule(c, RULE_EXPAND))    client_expand(c, HORIZONTAL|VERTICAL, 0, 0, 0, 0, 0, 0, 0, 0);
-	if (client_rule(c, RULE_REPLACE))   client_replace(c);
-	if (client_rule(c, RULE_DUPLICATE)) client_duplicate(c);
-	// tiling
-	if (client_rule(c, RULE_HUNTILE)) client_huntile(c);
-	if (client_rule(c, RULE_HTILE))   client_htile(c);
-	if (client_rule(c, RULE_VUNTILE)) client_vuntile(c);
-	if (client_rule(c, RULE_VTILE))   client_vtile(c);
+		// toggle from nothing, so the window ends up with exactly the rule's tags
+		bitmap old = c->cache->tags; c->cache->tags = 0;
+		tag_members_update(c->window, old, 0);
+		client_toggle_tag(c, c->rule->tags & TAGMASK, NOFLASH);
+	}
+}
+
+// run a rule's compiled ops in the range first..last, in order
+void client_rules_ops(client *c, winrule *rule, int first, int last)
+{
+	int i; bitmap tag = current_tag;
+	for (i = 0; i < rule->nops; i++)
+	{
+		int op = rule->ops[i];
+		if (op < first || op > last) continue;
+		// post-placement ops work on the window's own tag
+		current_tag = op >= RULEOP_SNAPRIGHT && op <= RULEOP_VTILE
+			? desktop_to_tag(tag_to_desktop(c->cache->tags)): tag;
+
+		switch (op)
+		{
+			case RULEOP_STATES:    client_rules_ewmh(c); break;
+			case RULEOP_GEOMETRY:  client_rules_geometry(c); break;
+			case RULEOP_LOCKS:     client_rules_locks(c); break;
+			case RULEOP_TAGS:      client_rules_tags(c); break;
+			case RULEOP_SNAPRIGHT: client_snapto(c, SNAPRIGHT); break;
+			case RULEOP_SNAPLEFT:  client_snapto(c, SNAPLEFT); break;
+			case RULEOP_SNAPDOWN:  client_snapto(c, SNAPDOWN); break;
+			case RULEOP_SNAPUP:    client_snapto(c, SNAPUP); break;
+			// yes, can do both contract and expand in one rule. it makes sense...
+			case RULEOP_CONTRACT:  client_contract(c, HORIZONTAL|VERTICAL); break;
+			case RULEOP_EXPAND:    client_expand(c, HORIZONTAL|VERTICAL, 0, 0, 0, 0, 0, 0, 0, 0); break;
+			case RULEOP_REPLACE:   client_replace(c); break;
+			case RULEOP_DUPLICATE: client_duplicate(c); break;
+			case RULEOP_HUNTILE:   client_huntile(c); break;
+			case RULEOP_HTILE:     client_htile(c); break;
+			case RULEOP_VUNTILE:   client_vuntile(c); break;
+			case RULEOP_VTILE:     client_vtile(c); break;
+			case RULEOP_LOWER:     client_lower(c, 0); break;
+			case RULEOP_RAISE:     client_raise(c, 0); break;
+			case RULEOP_RESTORE:   client_restore(c); break;
+			case RULEOP_MINIMIZE:  client_minimize(c); break;
+		}
+	}
 	current_tag = tag;
 }
 
-// check and apply all possible rules to a client
+// check and apply all possible rules to a client, running the rule's compiled ops
 void client_rules_apply(client *c, bool reset)
 {
-	if (client_rule(c, RULE_RESET) || reset)
+	winrule *rule = client_rule(c, 0);
+
+	if (reset || (rule && rule->flags & RULE_RESET))
 	{
-		client_remove_all_states(c);
+		// written by client_rules_ewmh() if the rule sets states of its own
+		c->state = 0;
+		if (!rule || !(rule->flags & ruleops[RULEOP_STATES])) client_flush_state(c);
 		c->cache->vlock = 0;
 		c->cache->hlock = 0;
 	}
+	if (!rule) return;
+	// count X requests the rule generates
+	unsigned long request = NextRequest(display);
 
-	client_rules_ewmh(c);
-	client_rules_monitor(c);
-	client_rules_moveresize(c);
-	client_rules_locks(c);
-	client_rules_tags(c);
-	client_rules_moveresize_post(c);
-
-	if (client_rule(c, RULE_LOWER)) client_lower(c, 0);
-	if (client_rule(c, RULE_RAISE)) client_raise(c, 0);
-	if (client_rule(c, RULE_RESTORE))  client_restore(c);
-	if (client_rule(c, RULE_MINIMIZE)) client_minimize(c);
+	client_rules_ops(c, rule, 0, RULEOPS-1);
+	rule->xops += NextRequest(display) - request;
+	rule->applied++;
 }
 
 #ifdef DEBUG
@@ -2226,28 +2373,28 @@ void event_client_dump(client *c)
 	event_note("is_full:%d is_left:%d is_top:%d is_right:%d is_bottom:%d\n\tis_xcenter:%d is_ycenter:%d is_maxh:%d is_maxv:%d last_corner:%d",
 		c->is_full, c->is_left, c->is_top, c->is_right, c->is_bottom, c->is_xcenter, c->is_ycenter, c->is_maxh, c->is_maxv, c->cache->last_corner);
 	event_note("PMinSize:%d,%d,%d PMaxSize:%d,%d,%d PBaseSize:%d,%d,%d PResizeInc:%d,%d,%d PAspect:%d,%d/%d,%d/%d",
-		(c->xsize.flags & PMinSize ? 1: 0),
-			(c->xsize.flags & PMinSize ? c->xsize.min_width: 0),
-			(c->xsize.flags & PMinSize ? c->xsize.min_height: 0),
-		(c->xsize.flags & PMaxSize ? 1: 0),
-			(c->xsize.flags & PMaxSize ? c->xsize.max_width: 0),
-			(c->xsize.flags & PMaxSize ? c->xsize.max_height: 0),
-		(c->xsize.flags & PBaseSize ? 1: 0),
-			(c->xsize.flags & PBaseSize ? c->xsize.base_width: 0),
-			(c->xsize.flags & PBaseSize ? c->xsize.base_height: 0),
-		(c->xsize.flags & PResizeInc ? 1: 0),
-			(c->xsize.flags & PResizeInc ? c->xsize.width_inc: 0),
-			(c->xsize.flags & PResizeInc ? c->xsize.height_inc: 0),
-		(c->xsize.flags & PAspect ? 1: 0),
-			(c->xsize.flags & PAspect ? c->xsize.min_aspect.x: 0),
-			(c->xsize.flags & PAspect ? c->xsize.min_aspect.y: 0),
-			(c->xsize.flags & PAspect ? c->xsize.max_aspect.x: 0),
-			(c->xsize.flags & PAspect ? c->xsize.max_aspect.y: 0));
+		(c->xsize->flags & PMinSize ? 1: 0),
+			(c->xsize->flags & PMinSize ? c->xsize->min_width: 0),
+			(c->xsize->flags & PMinSize ? c->xsize->min_height: 0),
+		(c->xsize->flags & PMaxSize ? 1: 0),
+			(c->xsize->flags & PMaxSize ? c->xsize->max_width: 0),
+			(c->xsize->flags & PMaxSize ? c->xsize->max_height: 0),
+		(c->xsize->flags & PBaseSize ? 1: 0),
+			(c->xsize->flags & PBaseSize ? c->xsize->base_width: 0),
+			(c->xsize->flags & PBaseSize ? c->xsize->base_height: 0),
+		(c->xsize->flags & PResizeInc ? 1: 0),
+			(c->xsize->flags & PResizeInc ? c->xsize->width_inc: 0),
+			(c->xsize->flags & PResizeInc ? c->xsize->height_inc: 0),
+		(c->xsize->flags & PAspect ? 1: 0),
+			(c->xsize->flags & PAspect ? c->xsize->min_aspect.x: 0),
+			(c->xsize->flags & PAspect ? c->xsize->min_aspect.y: 0),
+			(c->xsize->flags & PAspect ? c->xsize->max_aspect.x: 0),
+			(c->xsize->flags & PAspect ? c->xsize->max_aspect.y: 0));
 	event_note("monitor: %d %d %d %d %d %d %d %d",
 		c->monitor.x, c->monitor.y, c->monitor.w, c->monitor.h, c->monitor.l, c->monitor.r, c->monitor.t, c->monitor.b);
 	int i, j;
 	for (i = 0; i < NETATOMS; i++) if (c->type == netatoms[i]) event_note("type:%s", netatom_names[i]);
-	for (i = 0; i < NETATOMS; i++) for (j = 0; j < c->states; j++) if (c->state[j] == netatoms[i]) event_note("state:%s", netatom_names[i]);
+	for (j = 0; j < CLIENTSTATE; j++) if (c->state & (1<<j)) event_note("state:%s", netatom_names[_NET_WM_STATE_MODAL+j]);
 	unsigned long struts[12];
 	if (window_get_cardinal_prop(c->window, netatoms[_NET_WM_STRUT_PARTIAL], struts, 12))
 		event_note("strut partial: %d %d %d %d %d %d %d %d %d %d %d %d",
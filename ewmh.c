@@ -53,19 +53,38 @@ void ewmh_active_window(Window w)
 	XChangeProperty(display, root, netatoms[_NET_ACTIVE_WINDOW], XA_WINDOW, 32, PropModeReplace, (unsigned char*)&w, 1);
 }
 
-// _NET_DESKTOP stuff, taking _NET_WM_STRUT* into account
+// _NET_DESKTOP stuff, taking _NET_WM_STRUT* into account.
+// each tag gets its own _NET_WORKAREA: a panel with _NET_WM_DESKTOP set only
+// reserves space on that desktop
 void ewmh_desktop_list()
 {
-	int i; XWindowAttributes *attr = window_get_attributes(root);
-	// nine desktops. want more space? buy more monitors and use xinerama :)
-	unsigned long desktops = TAGS, area[4*TAGS], geo[2], view[2], desktop;
+	int i, j; Window w; XWindowAttributes *attr = window_get_attributes(root);
+	unsigned long desktops = config_tags, *area = allocate(sizeof(unsigned long) * 4 * config_tags);
+	unsigned long geo[2], view[2], desktop, strut[12], d;
 
-	// this will return the full X screen, not Xinerama screen
-	workarea mon; monitor_dimensions_struts(-1, -1, &mon);
+	// struts per desktop, and in the last slot those on every desktop
+	int *sides = allocate_clear(sizeof(int) * 4 * (config_tags+1)), *all = &sides[4*config_tags];
 
-	// figure out the workarea, less struts
-	for (i = 0; i < TAGS; i++)
+	// walk the open apps once for struts
+	winlist_ascend(windows_in_play(), i, w)
+	{
+		// only panels and the like. see window_check_struts()
+		int idx = winlist_find(windows, w);
+		if (idx < 0 || !((wincache*)windows->data[idx])->has_struts) continue;
+		memset(strut, 0, sizeof(strut));
+		if (!window_get_cardinal_prop(w, netatoms[_NET_WM_STRUT_PARTIAL], strut, 12)
+			&& !window_get_cardinal_prop(w, netatoms[_NET_WM_STRUT], strut, 4)) continue;
+		int *s = all;
+		if (window_get_cardinal_prop(w, netatoms[_NET_WM_DESKTOP], &d, 1) && d < config_tags)
+			s = &sides[4*d];
+		for (j = 0; j < 4; j++) s[j] = MAX(s[j], strut[j]);
+	}
+	// this will return the full X screen, not Xinerama screen
+	for (i = 0; i < config_tags; i++)
 	{
+		workarea mon; monitor_dimensions(-1, -1, &mon);
+		int *s = &sides[4*i];
+		monitor_apply_struts(&mon, MAX(s[0], all[0]), MAX(s[1], all[1]), MAX(s[2], all[2]), MAX(s[3], all[3]));
 		area[(i*4)+0] = mon.x; area[(i*4)+1] = mon.y;
 		area[(i*4)+2] = mon.w; area[(i*4)+3] = mon.h;
 	}
@@ -77,6 +96,8 @@ void ewmh_desktop_list()
 	window_set_cardinal_prop(root, netatoms[_NET_NUMBER_OF_DESKTOPS], &desktops, 1);
 	window_set_cardinal_prop(root, netatoms[_NET_DESKTOP_GEOMETRY],   geo,  2);
 	window_set_cardinal_prop(root, netatoms[_NET_DESKTOP_VIEWPORT],   view, 2);
-	window_set_cardinal_prop(root, netatoms[_NET_WORKAREA],           area, TAGS*4);
+	window_set_cardinal_prop(root, netatoms[_NET_WORKAREA],           area, config_tags*4);
 	window_set_cardinal_prop(root, netatoms[_NET_CURRENT_DESKTOP],    &desktop, 1);
+	free(sides);
+	free(area);
 }
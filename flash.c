@@ -0,0 +1,87 @@
+/* GoomwWM, Get out of my way, Window Manager!
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// corner boxes are hidden again by a timer, so a flash costs a few requests and no round trips
+void flash_hide(void *data)
+{
+	winflash *f = data;
+	int i; for (i = 0; i < 4; i++) box_hide(f->corner[i]);
+	f->active = 0;
+	f->window = None;
+}
+
+// find a flash slot, preferring one already used for the same window
+winflash* flash_slot(Window w)
+{
+	int i; winflash *f = NULL;
+	for (i = 0; i < FLASHES; i++)
+		if (flashes[i].active && flashes[i].window == w) return &flashes[i];
+	for (i = 0; i < FLASHES; i++)
+		if (!flashes[i].active) return &flashes[i];
+	// all busy. steal the one closest to expiring
+	for (i = 0, f = &flashes[0]; i < FLASHES; i++)
+		if (flashes[i].expires < f->expires) f = &flashes[i];
+	return f;
+}
+
+// four coloured squares in the corners of an area
+void flash_show(Window w, int x, int y, int width, int height, char *color, int delay)
+{
+	int i; winflash *f = flash_slot(w);
+	int x1 = x, x2 = x + width  - config_flash_width;
+	int y1 = y, y2 = y + height - config_flash_width;
+
+	if (!f->corner[0])
+	{
+		for (i = 0; i < 4; i++)
+		{
+			f->corner[i] = box_create(root, BOX_OVERRIDE, 0, 0, 1, 1, color);
+			// never manage these. see handle_mapnotify()
+			window_set_ours(f->corner[i]->window);
+		}
+	}
+	timer_cancel(flash_hide, f);
+
+	// one color lookup for all corners
+	unsigned int pixel = color_get(color);
+	for (i = 0; i < 4; i++) f->corner[i]->color = pixel;
+
+	box_moveresize(f->corner[0], x1, y1, config_flash_width, config_flash_width);
+	box_moveresize(f->corner[1], x2, y1, config_flash_width, config_flash_width);
+	box_moveresize(f->corner[2], x1, y2, config_flash_width, config_flash_width);
+	box_moveresize(f->corner[3], x2, y2, config_flash_width, config_flash_width);
+
+	for (i = 0; i < 4; i++)
+	{
+		box_draw(f->corner[i]);
+		XMapRaised(display, f->corner[i]->window);
+	}
+
+	f->window = w;
+	f->active = 1;
+	f->expires = timestamp() + (double)delay/1000;
+	timer_add(delay, flash_hide, f);
+}
@@ -29,8 +29,13 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "goomwwm.h"
 #include "proto.h"
 #include "util.c"
+#include "timer.c"
+#include "loop.c"
+#include "launch.c"
 #include "box.c"
+#include "flash.c"
 #include "textbox.c"
+#include "notice.c"
 #include "winlist.c"
 #include "rule.c"
 #include "window.c"
@@ -41,6 +46,9 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "menu.c"
 #include "handle.c"
 #include "grab.c"
+#include "snapshot.c"
+#include "account.c"
+#include "ipc.c"
 #include "cli.c"
 #include "wm.c"
 
@@ -71,15 +79,19 @@ int main(int argc, char *argv[])
 		fprintf(stderr, "cannot open display!\n");
 		return EXIT_FAILURE;
 	}
-	signal(SIGCHLD, catch_exit);
 	screen = DefaultScreenOfDisplay(display);
 	screen_id = DefaultScreen(display);
 	root = DefaultRootWindow(display);
 
-	// X atom values
-	for (i = 0; i < ATOMS; i++) atoms[i] = XInternAtom(display, atom_names[i], False);
-	for (i = 0; i < GATOMS; i++) gatoms[i] = XInternAtom(display, gatom_names[i], False);
-	for (i = 0; i < NETATOMS; i++) netatoms[i] = XInternAtom(display, netatom_names[i], False);
+	// X atom values. one round trip for the lot
+	char *names[ATOMS+GATOMS+NETATOMS]; Atom values[ATOMS+GATOMS+NETATOMS];
+	for (i = 0; i < ATOMS; i++) names[i] = (char*)atom_names[i];
+	for (i = 0; i < GATOMS; i++) names[ATOMS+i] = (char*)gatom_names[i];
+	for (i = 0; i < NETATOMS; i++) names[ATOMS+GATOMS+i] = (char*)netatom_names[i];
+	XInternAtoms(display, names, ATOMS+GATOMS+NETATOMS, False, values);
+	memmove(atoms, values, sizeof(atoms));
+	memmove(gatoms, values+ATOMS, sizeof(gatoms));
+	memmove(netatoms, values+ATOMS+GATOMS, sizeof(netatoms));
 
 	return find_arg(argc, argv, "-cli") >= 0 ? cli_main(argc, argv): wm_main(argc, argv);
 }
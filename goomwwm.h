@@ -34,19 +34,32 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <X11/cursorfont.h>
 #include <X11/XKBlib.h>
 #include <X11/Xft/Xft.h>
+#include <X11/Xlib-xcb.h>
+#include <xcb/xcb.h>
 #include <stddef.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include <string.h>
 #include <stdarg.h>
 #include <unistd.h>
 #include <ctype.h>
 #include <math.h>
 #include <sys/time.h>
+#include <sys/select.h>
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <sys/signalfd.h>
+#endif
 #include <signal.h>
 #include <sys/wait.h>
+#include <spawn.h>
 #include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <errno.h>
 #include <regex.h>
 #include <err.h>
 #include <X11/extensions/Xinerama.h>
@@ -95,6 +108,7 @@ typedef struct {
 #define WINLIST 32
 #define MINWINDOW 16
 #define UNDO 10
+#define UNDOMAX 64
 #define TOPLEFT 1
 #define TOPRIGHT 2
 #define BOTTOMLEFT 3
@@ -117,7 +131,19 @@ typedef struct {
 #define SWAPRIGHT 2
 #define SWAPUP 3
 #define SWAPDOWN 4
-#define CLIENTSTATE 7
+// _NET_WM_STATE_MODAL .. _NET_WM_STATE_DEMANDS_ATTENTION, one bit each in client->state
+#define CLIENTSTATE 12
+#define TIMERS 32
+#define WHEEL 64
+#define WHEELMS 10
+#define FLASHES 4
+#define NOTICES 4
+#define LOOPFDS 8
+#define LAUNCHES 16
+#define LAUNCHMS 30000
+#define GRABMS 1000
+#define REGCACHE 8
+#define GRABRETRYMS 20
 
 // client_moveresize() flags
 #define MR_SMART 1<<1
@@ -125,18 +151,19 @@ typedef struct {
 #define MR_SNAPWH 1<<3
 #define MR_UNCONSTRAIN 1<<4
 
-#define TAG1 1
-#define TAG2 (1<<1)
-#define TAG3 (1<<2)
-#define TAG4 (1<<3)
-#define TAG5 (1<<4)
-#define TAG6 (1<<5)
-#define TAG7 (1<<6)
-#define TAG8 (1<<7)
-#define TAG9 (1<<8)
-#define TAGS 9
-
-// these must be above tag bits
+// tags are their own 64bit mask, separate from RULE_* flags. -tags sets how many are used
+#define TAGS 64
+#define TAGSDEF 9
+#define TAG(n) ((bitmap)1<<(n))
+#define TAGMASK (config_tags >= TAGS ? ~(bitmap)0: TAG(config_tags)-1)
+// walk set tag bits, lowest first
+#define tag_bits(i,t,m) for ((m) = (t); (m) && (((i) = __builtin_ctzll(m)) || 1); (m) &= (m)-1)
+
+// xinerama screens that can hold their own current tag with -monitortags
+#define MONITORS 8
+
+// rule has tagN flags. see winrule tags
+#define RULE_TAGS 1
 #define RULE_IGNORE 1<<9
 #define RULE_FULLSCREEN 1<<10
 #define RULE_ABOVE 1<<11
@@ -188,6 +215,16 @@ typedef struct {
 #define RULESDEF 0
 #define RULESRESET 1
 
+// compiled rule actions, in the order client_rules_apply() runs them
+enum {
+	RULEOP_STATES, RULEOP_GEOMETRY, RULEOP_LOCKS, RULEOP_TAGS,
+	RULEOP_SNAPRIGHT, RULEOP_SNAPLEFT, RULEOP_SNAPDOWN, RULEOP_SNAPUP,
+	RULEOP_CONTRACT, RULEOP_EXPAND, RULEOP_REPLACE, RULEOP_DUPLICATE,
+	RULEOP_HUNTILE, RULEOP_HTILE, RULEOP_VUNTILE, RULEOP_VTILE,
+	RULEOP_LOWER, RULEOP_RAISE, RULEOP_RESTORE, RULEOP_MINIMIZE,
+	RULEOPS
+};
+
 // just defaults, mostly configurable from command line
 #define BORDER 2
 #define FOCUS "Royal Blue"
@@ -227,6 +264,7 @@ typedef struct {
 #define FOCUSSLOPPYTAG 3
 #define RAISE 1
 #define RAISEDEF 0
+#define NORAISE -1
 #define WARP 1
 #define WARPDEF 0
 #define RAISEFOCUS 1
@@ -264,28 +302,190 @@ typedef struct {
 #define managed_ascend(i,w,c) clients_ascend(windows_in_play(),i,w,c) if ((c)->manage && (c)->visible)
 #define managed_descend(i,w,c) clients_descend(windows_in_play(),i,w,c) if ((c)->manage && (c)->visible)
 
-#define tag_ascend(i,w,c,t) managed_ascend(i, w, c) if (!(t) || (c)->cache->tags & (t))
-#define tag_descend(i,w,c,t) managed_descend(i, w, c) if (!(t) || (c)->cache->tags & (t))
+// only builds clients for windows in the tags. see tag_windows()
+#define tag_ascend(i,w,c,t) clients_ascend(tag_windows(t),i,w,c) if ((c)->manage && (c)->visible && (!(t) || (c)->cache->tags & (t)))
+#define tag_descend(i,w,c,t) clients_descend(tag_windows(t),i,w,c) if ((c)->manage && (c)->visible && (!(t) || (c)->cache->tags & (t)))
 
 // window lists
 typedef struct {
 	Window *array; // actual window ids
 	void **data;   // an associated struct
 	short len;
+	short size;    // capacity. pooled lists keep what they grew to
 } winlist;
 
 // usable space on a monitor
 typedef struct {
 	short x, y, w, h, l, r, t, b;
+	short n; // xinerama screen number
 } workarea;
 
 // snapshot a window's size/pos and EWMH state
-typedef struct _winundo {
-	short x, y, w, h, states;
-	Atom state[CLIENTSTATE];
-	struct _winundo *next;
+typedef struct {
+	short x, y, w, h;
+	unsigned short state; // EWMH states as in client->state
+	unsigned int txn; // multi-window undo step, or 0. see undo_begin()
 } winundo;
 
+// fixed depth LIFO of winundo. a push onto a full ring drops the oldest
+typedef struct {
+	winundo *cells; // allocated once, by the first push
+	short size, top, len;
+} winring;
+
+// scheduled callbacks. see timer_add()
+typedef void (*timer_callback)(void*);
+typedef struct _wintimer {
+	unsigned long long tick;  // absolute wheel tick at which to fire
+	timer_callback callback;  // NULL when node is free
+	void *data;
+	struct _wintimer *next;   // chain within a wheel slot
+} wintimer;
+
+// pending timers live in a hashed timer wheel of WHEEL slots, WHEELMS apart.
+// nodes come from a fixed pool, so scheduling never allocates
+wintimer timers[TIMERS];
+wintimer *timer_wheel[WHEEL];
+unsigned long long timer_tick;
+
+// extra file descriptors watched by the main event loop. see loop_add()
+typedef void (*loop_callback)(int fd, void *data);
+typedef struct {
+	int fd;
+	loop_callback callback;  // NULL when slot is free
+	void *data;
+} winloopfd;
+
+winloopfd loop_fds[LOOPFDS];
+// epoll set, timerfd for the timer wheel, signalfd for SIGCHLD/SIGHUP/SIGUSR1
+int loop_poll = -1, loop_timer = -1, loop_signal = -1;
+sigset_t loop_sigmask, loop_oldmask;
+volatile sig_atomic_t loop_caught;  // pselect() fallback only
+char **loop_argv;
+
+// a compiled regquick() pattern
+typedef struct {
+	char *pattern;
+	regex_t re;
+	bool ok;             // false if the pattern failed to compile
+	unsigned long used;  // for least recently used eviction
+} winregex;
+
+winregex regex_cache[REGCACHE];
+unsigned long regex_clock;
+
+// a keyboard or pointer grab that may still be pending. see take_keyboard()
+typedef void (*grab_callback)();
+typedef struct {
+	Window window;
+	unsigned long mask;
+	Cursor cursor;
+	double deadline;
+	grab_callback failed;  // cancels whatever mode wanted the grab
+	bool pending;
+} wingrab;
+
+wingrab grab_kbd, grab_ptr;
+
+// a process started by exec_cmd(), waiting for its first window to map
+typedef struct {
+	pid_t pid;
+	char id[64];     // DESKTOP_STARTUP_ID handed to the child
+	double started;
+	bool active;
+} winlaunch;
+
+// launch latency in milliseconds, spawn to first MapNotify
+typedef struct {
+	unsigned int spawned, failed, mapped, expired;
+	double total, min, max, last;
+} winlaunchstats;
+
+winlaunch launches[LAUNCHES];
+winlaunchstats launch_totals;
+unsigned int launch_serial;
+
+// a set of reusable corner boxes for client_flash()
+typedef struct {
+	box *corner[4];
+	Window window;  // client being flashed
+	double expires;
+	bool active;
+} winflash;
+
+// flash pool. boxes are created on first use and never destroyed
+winflash flashes[FLASHES];
+
+// a reusable popup message window. see notice_show()
+typedef struct {
+	box *frame;
+	textbox *text;
+	unsigned long key; // messages with the same key replace each other
+	double stamp;      // when shown, so the oldest can be recycled
+	bool active;
+} winnotice;
+
+// visible notices, stacked upward from their anchor points
+winnotice notices[NOTICES];
+
+#define NOTICE_STATUS 1
+#define NOTICE_NOTIFY 2
+
+// bump allocator. everything in it goes at once with arena_reset()
+#define ARENABLOCK 16384
+typedef struct _arenablock {
+	unsigned long size, used;
+	struct _arenablock *next;
+	char data[];
+} arenablock;
+
+typedef struct {
+	arenablock *head, *cur;
+	unsigned long allocs, resets, blocks, bytes;
+} arena;
+
+// client records and their strings live until reset_cache_client(). if nothing
+// resets the cache for a long time, it is reset between events past this size
+#define CLIENTARENA (256*1024)
+arena client_arena;
+
+// cache_xattr entries, dropped every loop turn by reset_cache_xattr()
+arena xattr_arena;
+
+// shared, refcounted copies of window strings. see intern()
+#define INTERNS 256
+typedef struct _interned {
+	struct _interned *next;
+	unsigned int refs, hash;
+	char str[];
+} interned;
+
+interned *intern_table[INTERNS];
+int interned_strings = 0;
+long interned_bytes = 0;
+
+// which wincache strings are current
+#define DESCRIBED_TITLE 1
+#define DESCRIBED_CLASS 2
+
+// spare temporary lists. see winlist_new()
+#define WINLISTPOOL 32
+winlist *winlist_pool[WINLISTPOOL];
+short winlist_pooled = 0;
+
+// allocate() and reallocate() calls, to verify hot paths stay off the heap
+unsigned long heap_allocs = 0;
+
+// spare frames and titlebars from destroyed windows. see client_decorate()
+#define FRAMEPOOL 16
+typedef struct {
+	box *frame;
+	textbox *title;
+} winframe;
+
+winframe frame_pool[FRAMEPOOL];
+short frame_pooled = 0;
+
 // track general window stuff
 // every window we know about gets one of these, even if it's empty
 typedef struct {
@@ -293,33 +493,55 @@ typedef struct {
 	int last_corner;   // the last screen corner, used to make corner seem sticky during resizing
 	bool hlock, vlock; // horizontal and vertical size/position locks
 	bool has_mapped;   // true when a client has mapped previously. used to avoid applying rules
-	unsigned int tags; // desktop tags
+	bool has_struts;   // reserves screen space. see window_check_struts()
+	bitmap tags;       // desktop tags
 	winundo *ewmh;     // undo size/pos for EWMH FULLSCREEN/MAXIMIZE_HORZ/MAXIMIZE_VERT toggles
-	winundo *undo;     // general size/pos undo LIFO linked list
+	winring undo;      // general size/pos undo LIFO, -undodepth deep
 	box *frame;        // titlebar & border, but NOT reparented!
 	textbox *title;
+	// interned WM_CLASS and title strings, fetched once and dropped on PropertyNotify
+	char *wm_class, *wm_name, *wm_title;
+	unsigned char described;
 	bool is_ours;      // set for any windows goomwwm creates
 	Window app;
+	// memoised client_rule() match. valid while rule_gen == rule_generation and
+	// rule_list == config_rules. reset when class, name, title or type change
+	struct _rule *rule, *rule_list;
+	unsigned int rule_gen;
 } wincache;
 
 // rule for controlling window size/pos/behaviour
 typedef struct _rule {
 	char *pattern; // POSIX regex pattern to match on class/name/title
 	regex_t re;    // precompiled regex
+	char *literal;   // pattern has no regex syntax. matched with strcasestr()
+	char *prefilter; // a substring any regex match must contain, checked before regexec()
+	char field;      // c, n, t or e for class:, name:, title: or edge: patterns. 0 for any
 	bitmap flags;  // RULE_* flags
+	unsigned char ops[RULEOPS]; // RULEOP_* program compiled from flags
+	short nops;
+	// profiling. see rule_dump()
+	unsigned long attempts, hits, applied, xops;
+	double regex_time;
 	short w, h;    // manually specified width/height
 	bool w_is_pct, h_is_pct; // true if w/h is a percentage of screen size
+	bitmap tags;   // tagN flags
 	struct _rule *next;
 } winrule;
 
 // all global rules. this is separate from rule sets!
 winrule *config_rules = NULL;
 
+// bumped whenever rules are created or freed, to invalidate memoised matches
+unsigned int rule_generation = 1;
+
 // a set of rules to execute in order, like a mini script.
 // this is separate from global rules!
 typedef struct _ruleset {
 	char *name;     // any name, for disply in the popup menu
 	winrule *rules; // linked list of rules in reverse-definition order
+	winrule **list; // the same rules as an array in definition order
+	int count;
 	struct _ruleset *next;
 } winruleset;
 
@@ -333,15 +555,6 @@ typedef struct {
 } winrulemap;
 
 winrulemap rulemap[] = {
-	{ "tag1", TAG1 },
-	{ "tag2", TAG2 },
-	{ "tag3", TAG3 },
-	{ "tag4", TAG4 },
-	{ "tag5", TAG5 },
-	{ "tag6", TAG6 },
-	{ "tag7", TAG7 },
-	{ "tag8", TAG8 },
-	{ "tag9", TAG9 },
 	{ "ignore", RULE_IGNORE },
 	{ "above", RULE_ABOVE },
 	{ "sticky", RULE_STICKY },
@@ -393,47 +606,53 @@ winrulemap rulemap[] = {
 // a placeholder
 char *empty = "";
 
-// collect and store data on a window
+// the parts of XWindowAttributes a client uses
+typedef struct {
+	short x, y, width, height, border_width;
+	unsigned char map_state;
+	bool override_redirect;
+} clientattr;
+
+// collect and store data on a window. what loops over many windows test comes
+// first, so walking managed_ascend() and friends mostly stays in one cache line
 typedef struct {
 	Window window;           // window's id
-	Window trans;            // our transient_for
-	XWindowAttributes xattr; // copy of cache_xattr data
-	XSizeHints xsize;        // only loaded after client_extended_data()
+	wincache *cache;         // a persistent cache for this window (clients are freed each event)
+	Atom type;               // EWMH type
 	short x, y, w, h;        // size/pos pulled from xattr + borders
-	short states;            // number of EWMH states set
-	short initial_state;     // pulled from wm hints
+	unsigned short state;    // EWMH states, bit i is _NET_WM_STATE_MODAL+i. see client_has_state()
 	short border_width;      // pulled from xwindowattributes
 	short titlebar_height;
 	// general flags
-	bool manage, visible, input, focus, active, minimized, shaded, decorate, urgent;
-	bool is_full, is_left, is_top, is_right, is_bottom, is_xcenter, is_ycenter;
-	bool is_maxh, is_maxv, is_described, is_extended, is_ruled;
+	bool manage:1, visible:1, input:1, focus:1, active:1, minimized:1, shaded:1, decorate:1, urgent:1;
+	bool is_full:1, is_left:1, is_top:1, is_right:1, is_bottom:1, is_xcenter:1, is_ycenter:1;
+	bool is_maxh:1, is_maxv:1, is_described:1, is_extended:1, is_ruled:1;
+	// colder stuff
+	Window trans;            // our transient_for
+	short initial_state;     // pulled from wm hints
+	clientattr xattr;        // copy of cache_xattr data
 	// descriptive buffers loaded after client_descriptive_data()
 	char *title, *class, *name;
-	// EWMH states and type
-	Atom state[CLIENTSTATE], type;
 	workarea monitor; // monitor holding the window, with strut padding detected
-	wincache *cache;  // a persistent cache for this window (clients are freed each event)
 	winrule *rule;    // loaded after client_rule
+	XSizeHints *xsize; // loaded into client_arena by client_extended_data(). empty until then
 } client;
 
+// what client->xsize points to before client_extended_data()
+XSizeHints no_size_hints;
+
 // built-in filterable popup menu list
+typedef void (*menu_callback)(int line, char *text, void *data);
 struct localmenu {
 	Window window;
-	GC gc;
-	Pixmap canvas;
-	XftFont *font;
-	XftColor *color;
-	XftDraw *draw;
-	XftColor fg, bg, hlfg, hlbg, bgalt;
-	unsigned long xbg;
+	textbox *text, **boxes;
 	char **lines, **filtered;
-	short done, max_lines, num_lines, input_size, line_height;
-	short current, width, height, horz_pad, vert_pad, offset;
-	char *input, *selected, *prompt;
-	XIM xim;
-	XIC xic;
+	int *line_map;
+	short num_lines, max_lines, filtered_lines, selected;
+	menu_callback callback;
+	void *data;
 };
+struct localmenu *menu_active = NULL;
 
 
 // config settings
@@ -443,7 +662,9 @@ unsigned int config_modkey, config_prefix_mode,
 	config_map_mode, config_menu_select, config_menu_width,
 	config_menu_lines, config_focus_mode, config_raise_mode,
 	config_window_placement, config_only_auto, config_resize_inc,
-	config_tile_mode, config_titlebar_height;
+	config_tile_mode, config_titlebar_height, config_rule_stats,
+	config_appkeys_swapped, config_tag_grab, config_tags,
+	config_monitor_tags, config_undo;
 
 char *config_border_focus, *config_border_blur, *config_border_attention,
 	*config_menu_font, *config_menu_fg, *config_menu_bg,
@@ -453,6 +674,13 @@ char *config_border_focus, *config_border_blur, *config_border_attention,
 	*config_menu_bc, *config_resizeinc_ignore,
 	*config_flash_on, *config_flash_off;
 
+// merged command line and .goomwwmrc arguments. see config_args()
+int config_ac;
+char **config_av;
+
+// -resizehints smart pattern, compiled once at startup
+regex_t config_resizeinc_re;
+
 char *config_switcher, *config_launcher, *config_apps_patterns[10];
 // these must be the same size and keys must remain in ascending order (regardless of key value/position order)
 KeySym config_apps_keysyms[] = { XK_1,  XK_2,  XK_3,  XK_4,  XK_5,  XK_6,  XK_7,  XK_8,  XK_9,  XK_0, 0 };
@@ -527,6 +755,11 @@ unsigned int config_modkeycodes[MAXMODCODES+1];
 enum { KEYLIST(KEY_ENUM) };
 KeySym keymap[] = { KEYLIST(KEY_KSYM), 0 };
 unsigned int keymodmap[] = { KEYLIST(KEY_KMOD), 0 };
+// pristine copies, so a config reload starts from the defaults
+KeySym keymap_default[] = { KEYLIST(KEY_KSYM), 0 };
+unsigned int keymodmap_default[] = { KEYLIST(KEY_KMOD), 0 };
+// room for every grab_combos() entry: configurable keys, plus app and tag keys with and without shift
+#define GRABCOMBOS (sizeof(keymap)/sizeof(KeySym) + 40)
 char *keyargs[] = { KEYLIST(KEY_CARG), NULL };
 
 unsigned int NumlockMask = 0;
@@ -538,7 +771,7 @@ Time latest = CurrentTime;
 
 struct mouse_drag {
 	XButtonEvent button;
-	XWindowAttributes attr;
+	clientattr attr;
 	box *overlay;
 	short x, y, w, h;
 	unsigned int flags;
@@ -552,12 +785,43 @@ Window supporting;
 
 // tracking windows
 winlist *windows, *windows_activated, *windows_minimized, *windows_shaded;
-unsigned int current_tag = TAG1;
+bitmap current_tag = TAG(0);
+// multi-window undo step being recorded, the last id used, and begin/end nesting
+unsigned int undo_txn = 0, undo_txns = 0;
+short undo_nest = 0;
+
+// with -monitortags, each monitor's tag. current_tag follows the active monitor
+bitmap monitor_tags[MONITORS];
+
+// windows carrying each tag, in no particular order. see tag_members_update()
+winlist *tag_members[TAGS];
 
 // caches used to reduce X server round trips
 winlist *cache_client;
 winlist *cache_xattr;
 winlist *cache_inplay;
+// tag mask -> windows_in_play() members of those tags. see tag_windows()
+winlist *cache_tagged;
+
+// properties read in bulk at startup. see window_prefetch()
+#define PREFETCH 10
+#define PREFETCHLEN 64
+typedef struct {
+	Atom atom, type;
+	int format, items;
+	bool complete;   // false if the property was longer than PREFETCHLEN
+	void *value;
+} winprop;
+
+typedef struct {
+	winprop prop[PREFETCH];
+	short count;
+} winprops;
+
+// only set while setup_screen() adopts existing windows
+winlist *cache_prop = NULL;
+Atom prefetch_atoms[PREFETCH];
+Window cache_focus;
 
 workarea cache_monitor[6];
 
@@ -598,6 +862,7 @@ Atom atoms[ATOMS];
 	X(_NET_MOVERESIZE_WINDOW),\
 	X(_NET_WM_NAME),\
 	X(_NET_WM_PID),\
+	X(_NET_STARTUP_ID),\
 	X(_NET_WM_WINDOW_TYPE),\
 	X(_NET_WM_WINDOW_TYPE_DESKTOP),\
 	X(_NET_WM_WINDOW_TYPE_DOCK),\
@@ -663,8 +928,64 @@ Atom netatoms[NETATOMS];
 	X(GOOMWWM_RULE),\
 	X(GOOMWWM_NOTICE),\
 	X(GOOMWWM_FIND_OR_START),\
-	X(GOOMWWM_RESTART)
+	X(GOOMWWM_RESTART),\
+	X(GOOMWWM_STATS),\
+	X(GOOMWWM_RELOAD),\
+	X(GOOMWWM_SNAPSHOT),\
+	X(GOOMWWM_RESOURCES),\
+	X(GOOMWWM_EXEC)
 
 enum { GOOMWWM_ATOMS(ATOM_ENUM), GATOMS };
 const char *gatom_names[] = { GOOMWWM_ATOMS(ATOM_CHAR) };
+
+// X resources and memory goomwwm holds. X resources are counted where they are
+// created and freed, the rest is measured by account_sample(). see account.c
+#define ACCOUNTS(X) \
+	X(windows),\
+	X(pixmaps),\
+	X(gcs),\
+	X(fonts),\
+	X(colors),\
+	X(wincache),\
+	X(wincache_bytes),\
+	X(arena_bytes),\
+	X(string_bytes),\
+	X(spare_lists),\
+	X(rss_kb)
+
+#define ACCOUNT_ENUM(x) ACCOUNT_##x
+enum { ACCOUNTS(ACCOUNT_ENUM), ACCOUNTN };
+const char *account_names[] = { ACCOUNTS(ATOM_CHAR) };
+long accounts[ACCOUNTN];
+
+// a category is flagged when it has not shrunk across ACCOUNTSAMPLES samples
+// taken ACCOUNTMS apart, and ended higher than it started
+#define ACCOUNTSAMPLES 12
+#define ACCOUNTMS (5*60*1000)
+long account_samples[ACCOUNTSAMPLES][ACCOUNTN];
+int account_sampled = 0;
+
+// allocated named colors. see color_get()
+#define COLORS 32
+struct {
+	char *name;
+	unsigned int pixel;
+} colors[COLORS];
+short colors_len = 0;
+
+// control socket for -cli. see ipc.c for the framing. commands are the GOOMWWM_*
+// atoms above, named without the prefix
+#define IPCPREFIX 8
+#define IPCCONNS 4
+#define IPCCHUNK 4096
+#define IPCMAX 65536
+#define IPCTIMEOUT 10
+typedef struct {
+	int fd;  // -1 when slot is free. see ipc_setup()
+	char *buf;
+	int len, size;
+} winipc;
+winipc ipc_conns[IPCCONNS];
+int ipc_listen = -1, ipc_current = -1;
+pid_t ipc_pid;
 Atom gatoms[GATOMS];
@@ -24,22 +24,21 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 */
 
-// bind to a keycode in all lock states
-void grab_keycode(unsigned int mask, KeyCode keycode)
+// bind or unbind a keycode in all lock states
+void grab_keycode(unsigned int mask, KeyCode keycode, int grab)
 {
-	XGrabKey(display, keycode, mask, root, True, GrabModeAsync, GrabModeAsync);
-	XGrabKey(display, keycode, mask|LockMask, root, True, GrabModeAsync, GrabModeAsync);
-	if (NumlockMask)
+	unsigned int i, masks[4] = { mask, mask|LockMask, mask|NumlockMask, mask|NumlockMask|LockMask };
+	for (i = 0; i < (NumlockMask ? 4: 2); i++)
 	{
-		XGrabKey(display, keycode, mask|NumlockMask, root, True, GrabModeAsync, GrabModeAsync);
-		XGrabKey(display, keycode, mask|NumlockMask|LockMask, root, True, GrabModeAsync, GrabModeAsync);
+		if (grab) XGrabKey(display, keycode, masks[i], root, True, GrabModeAsync, GrabModeAsync);
+		else XUngrabKey(display, keycode, masks[i], root);
 	}
 }
 
-// grab a MODKEY+key combo
-void grab_key(unsigned int mask, KeySym key)
+// grab or ungrab a MODKEY+key combo
+void grab_key(unsigned int mask, KeySym key, int grab)
 {
-	grab_keycode(mask, XKeysymToKeycode(display, key));
+	grab_keycode(mask, XKeysymToKeycode(display, key), grab);
 	int i, j, min_code, max_code, syms_per_code;
 	// if xmodmap is in use to remap keycodes to keysyms, a simple XKeysymToKeycode
 	// may not suffice here. so we also walk the entire map of keycodes and bind to
@@ -49,32 +48,66 @@ void grab_key(unsigned int mask, KeySym key)
 	for (i = 0; map && i < (max_code-min_code); i++)
 		for (j = 0; j < syms_per_code; j++)
 			if (key == map[i*syms_per_code+j])
-				grab_keycode(mask, i+min_code);
+				grab_keycode(mask, i+min_code, grab);
 	if (map) XFree(map);
 }
 
-// run at startup and on MappingNotify
-void grab_keys_and_buttons()
+// list every key combo the current config needs grabbed. arrays must hold GRABCOMBOS
+int grab_combos(KeySym *syms, unsigned int *masks)
 {
-	int i;
-	XUngrabKey(display, AnyKey, AnyModifier, root);
-	// only grab keys if prefix mode is disabled (default)
-	if (!config_prefix_mode)
+	int i, n = 0;
+	// prefix mode key switches to XGrabKeyboard
+	if (config_prefix_mode)
+	{
+		syms[n] = keymap[KEY_PREFIX]; masks[n++] = config_modkey;
+		return n;
+	}
+	// configurable keys
+	for (i = 0; keymap[i]; i++) if (keymap[i] != XK_VoidSymbol)
+		{ syms[n] = keymap[i]; masks[n++] = keymodmap[i]; }
+
+	// 1-9 app keys
+	for (i = 0; config_apps_keysyms[i]; i++) if (config_apps_patterns[i])
+	{
+		syms[n] = config_apps_keysyms[i]; masks[n++] = config_modkey;
+		syms[n] = config_apps_keysyms[i]; masks[n++] = config_modkey|ShiftMask;
+	}
+	// F1-F9 tag keys
+	for (i = 0; config_tags_keysyms[i]; i++)
 	{
-		// configurable keys
-		for (i = 0; keymap[i]; i++) if (keymap[i] != XK_VoidSymbol)
-			grab_key(keymodmap[i], keymap[i]);
+		syms[n] = config_tags_keysyms[i]; masks[n++] = config_modkey;
+		syms[n] = config_tags_keysyms[i]; masks[n++] = config_modkey|ShiftMask;
+	}
+	return n;
+}
 
-		// 1-9 app keys
-		for (i = 0; config_apps_keysyms[i]; i++) if (config_apps_patterns[i])
-			{ grab_key(config_modkey, config_apps_keysyms[i]); grab_key(config_modkey|ShiftMask, config_apps_keysyms[i]); }
+// after a config reload, ungrab combos no longer used and grab new ones. the rest stay put
+void grab_keys_update(KeySym *old_syms, unsigned int *old_masks, int old_n)
+{
+	KeySym syms[GRABCOMBOS]; unsigned int masks[GRABCOMBOS];
+	int i, j, n = grab_combos(syms, masks);
 
-		// F1-F9 tag keys
-		for (i = 0; config_tags_keysyms[i]; i++)
-			{ grab_key(config_modkey, config_tags_keysyms[i]); grab_key(config_modkey|ShiftMask, config_tags_keysyms[i]); }
+	for (i = 0; i < old_n; i++)
+	{
+		for (j = 0; j < n && !(syms[j] == old_syms[i] && masks[j] == old_masks[i]); j++);
+		if (j == n) grab_key(old_masks[i], old_syms[i], 0);
 	}
-	// prefix mode key switches to XGrabKeyboard
-	else grab_key(config_modkey, keymap[KEY_PREFIX]);
+	for (i = 0; i < n; i++)
+	{
+		for (j = 0; j < old_n && !(old_syms[j] == syms[i] && old_masks[j] == masks[i]); j++);
+		if (j == old_n) grab_key(masks[i], syms[i], 1);
+	}
+}
+
+// run at startup and on MappingNotify
+void grab_keys_and_buttons()
+{
+	int i, n;
+	KeySym syms[GRABCOMBOS]; unsigned int masks[GRABCOMBOS];
+	XUngrabKey(display, AnyKey, AnyModifier, root);
+	for (i = 0, n = grab_combos(syms, masks); i < n; i++)
+		grab_key(masks[i], syms[i], 1);
+
 	// grab mouse buttons for click-to-focus. these get passed through to the windows
 	// not binding on button4 which is usually wheel scroll
 	XUngrabButton(display, AnyButton, AnyModifier, root);
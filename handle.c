@@ -32,6 +32,32 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 	(prefix_mode_active && (keymodmap[id] & ~keymodmap[KEY_PREFIX]) == (state & ~keymodmap[KEY_PREFIX]))\
 ))
 
+// leave prefix mode
+void prefix_cancel()
+{
+	release_keyboard();
+	release_pointer();
+	prefix_mode_active = 0;
+}
+
+// end a mouse move or resize
+void drag_cancel()
+{
+	release_pointer();
+	if (mouse_dragger)
+	{
+		box_free(mouse_dragger->overlay);
+		free(mouse_dragger);
+		mouse_dragger = NULL;
+	}
+	// deactivate prefix mode if necessary
+	if (prefix_mode_active)
+	{
+		release_keyboard();
+		prefix_mode_active = 0;
+	}
+}
+
 // MODKEY+keys
 void handle_keypress(XEvent *ev)
 {
@@ -51,8 +77,8 @@ void handle_keypress(XEvent *ev)
 	if (ISKEY(KEY_PREFIX) && !prefix_mode_active)
 	{
 		// activate prefix mode
-		take_keyboard(ev->xany.window);
-		take_pointer(ev->xany.window, ButtonPressMask, prefix_cursor);
+		take_keyboard(ev->xany.window, prefix_cancel);
+		take_pointer(ev->xany.window, ButtonPressMask, prefix_cursor, prefix_cancel);
 		prefix_mode_active = 1;
 		reset_prefix = 0;
 	}
@@ -69,9 +95,7 @@ void handle_keypress(XEvent *ev)
 	// simple run dialog
 	if (ISKEY(KEY_COMMAND))
 	{
-		char *cmd = prompt("$ ");
-		if (cmd && *cmd) exec_cmd(cmd);
-		free(cmd);
+		prompt("$ ", prompt_exec, NULL);
 	}
 
 	else
@@ -93,11 +117,11 @@ void handle_keypress(XEvent *ev)
 		client_start(config_apps_patterns[i]);
 
 	else if ((i = in_array_keysym(config_tags_keysyms, key)) >= 0 && state == config_modkey && key != XK_0)
-		tag_raise(1<<i);
+		{ if (i < config_tags) tag_raise(TAG(i)); }
 
 	// tag cycling
-	else if (ISKEY(KEY_TAGNEXT))  tag_raise(current_tag & TAG9 ? TAG1: current_tag<<1);
-	else if (ISKEY(KEY_TAGPREV))  tag_raise(current_tag & TAG1 ? TAG9: current_tag>>1);
+	else if (ISKEY(KEY_TAGNEXT))  tag_raise(current_tag & TAG(config_tags-1) ? TAG(0): current_tag<<1);
+	else if (ISKEY(KEY_TAGPREV))  tag_raise(current_tag & TAG(0) ? TAG(config_tags-1): current_tag>>1);
 	else if (ISKEY(KEY_TAGONLY))  tag_only(current_tag);
 	else if (ISKEY(KEY_TAGCLOSE)) tag_close(current_tag);
 
@@ -142,7 +166,7 @@ void handle_keypress(XEvent *ev)
 		else if (ISKEY(KEY_VTILE))      client_vtile(c);
 		else if (ISKEY(KEY_HUNTILE))    client_huntile(c);
 		else if (ISKEY(KEY_VUNTILE))    client_vuntile(c);
-		else if (ISKEY(KEY_UNDO))       client_rollback(c);
+		else if (ISKEY(KEY_UNDO))       client_undo(c);
 		else if (ISKEY(KEY_DUPLICATE))  client_duplicate(c);
 		else if (ISKEY(KEY_MINIMIZE))   client_minimize(c);
 		else if (ISKEY(KEY_RULE))       client_rules_apply(c, RULESRESET);
@@ -168,9 +192,9 @@ void handle_keypress(XEvent *ev)
 			ewmh_client_list();
 		}
 		// place client in other tags
-		else if ((i = in_array_keysym(config_tags_keysyms, key)) >= 0 && state == (config_modkey|ShiftMask))
+		else if ((i = in_array_keysym(config_tags_keysyms, key)) >= 0 && state == (config_modkey|ShiftMask) && i < config_tags)
 		{
-			client_toggle_tag(c, 1<<i, FLASH);
+			client_toggle_tag(c, TAG(i), FLASH);
 			ewmh_client_list();
 		}
 
@@ -185,10 +209,10 @@ void handle_keypress(XEvent *ev)
 			flags |= MR_SMART; fx = c->x; fy = c->y;
 
 			// for windows with resize increments, be a little looser detecting their zone
-			if (c->xsize.flags & PResizeInc)
+			if (c->xsize->flags & PResizeInc)
 			{
-				vague = MAX(vague, c->xsize.width_inc);
-				vague = MAX(vague, c->xsize.height_inc);
+				vague = MAX(vague, c->xsize->width_inc);
+				vague = MAX(vague, c->xsize->height_inc);
 			}
 
 			// window width zone
@@ -322,11 +346,7 @@ void handle_keypress(XEvent *ev)
 	}
 	// deactivate prefix mode if necessary. only one operation at a time
 	if (prefix_mode_active && reset_prefix)
-	{
-		release_keyboard();
-		release_pointer();
-		prefix_mode_active = 0;
-	}
+		prefix_cancel();
 
 	// reset quit key if a non-quit keypress arrives
 	if (reset_quit)
@@ -367,7 +387,7 @@ void handle_buttonpress(XEvent *ev)
 		if (is_mod)
 		{
 			if (prefix_mode_active) release_pointer();
-			take_pointer(c->window, PointerMotionMask|ButtonReleaseMask, None);
+			take_pointer(c->window, PointerMotionMask|ButtonReleaseMask, None, drag_cancel);
 
 			mouse_dragger = allocate_clear(sizeof(struct mouse_drag));
 			mouse_dragger->overlay = box_create(root, BOX_OVERRIDE, c->x, c->y, c->w, c->h, config_border_blur);
@@ -429,21 +449,18 @@ void handle_buttonrelease(XEvent *ev)
 				client_lower(c, 0);
 		}
 
-		release_pointer();
-		box_free(mouse_dragger->overlay);
-		free(mouse_dragger);
-		mouse_dragger = NULL;
-
-		// deactivate prefix mode if necessary
-		if (prefix_mode_active)
-		{
-			release_keyboard();
-			prefix_mode_active = 0;
-		}
+		drag_cancel();
 	}
 	ewmh_client_list();
 }
 
+// a grab we asked for may be released by another client
+void handle_focus(XEvent *ev)
+{
+	if (grab_kbd.pending || grab_ptr.pending)
+		take_retry(NULL);
+}
+
 void handle_motionnotify(XEvent *ev)
 {
 	// compress events to reduce window jitter and CPU load
@@ -486,10 +503,15 @@ void handle_motionnotify(XEvent *ev)
 void handle_createnotify(XEvent *ev)
 {
 	reset_cache_inplay();
+	// popups and tooltips come and go constantly. client_create() caches them if ever needed
+	if (ev->xcreatewindow.override_redirect) return;
 	if (winlist_find(windows, ev->xcreatewindow.window) < 0)
 	{
 		wincache *cache = allocate_clear(sizeof(wincache));
 		winlist_append(windows, ev->xcreatewindow.window, cache);
+		// docks are never window_select()ed. watch them before reading, so no strut is missed
+		XSelectInput(display, ev->xcreatewindow.window, PropertyChangeMask);
+		window_check_struts(ev->xcreatewindow.window, cache);
 	}
 }
 
@@ -505,15 +527,13 @@ void handle_destroynotify(XEvent *ev)
 	{
 		wincache *cache = windows->data[idx];
 
-		// destroy titlebar/borders
-		if (cache->title) textbox_free(cache->title);
-		if (cache->frame) box_free(cache->frame);
-
-		// free undo chain
-		winundo *next, *undo = cache->undo;
-		while (undo) { next = undo->next; free(undo); undo = next; }
+		// recycle titlebar/borders
+		client_undecorate(cache);
 
+		winring_free(&cache->undo);
+		client_forget_strings(cache, DESCRIBED_TITLE|DESCRIBED_CLASS);
 		free(cache->ewmh);
+		tag_members_update(win, cache->tags, 0);
 	}
 	winlist_forget(windows, win);
 	winlist_forget(windows_activated, win);
@@ -655,10 +675,15 @@ void handle_maprequest(XEvent *ev)
 		// resulting in a little jump on screen. ensure border is done first
 		client_review_border(c);
 		client_deactivate(c, client_active(0));
+
+		// -rulestats profile, counted as client_rules_apply() does. default placement is left out
+		winrule *rule = client_rule(c, 0);
+		unsigned long request = NextRequest(display), placing;
 		client_rules_ewmh(c);
+		placing = NextRequest(display);
 
 		// PLACEPOINTER: center window on pointer
-		if (config_window_placement == PLACEPOINTER && !(c->xsize.flags & (PPosition|USPosition)))
+		if (config_window_placement == PLACEPOINTER && !(c->xsize->flags & (PPosition|USPosition)))
 		{
 			// figure out which monitor holds the pointer, so we can nicely keep the window on-screen
 			int x, y; pointer_get(&x, &y);
@@ -668,7 +693,7 @@ void handle_maprequest(XEvent *ev)
 		else
 		// PLACEANY: windows which specify position hints are honored, all else gets centered on screen or their parent
 		// PLACECENTER: centering is enforced
-		if ((config_window_placement == PLACEANY && !(c->xsize.flags & (PPosition|USPosition))) || (config_window_placement == PLACECENTER))
+		if ((config_window_placement == PLACEANY && !(c->xsize->flags & (PPosition|USPosition))) || (config_window_placement == PLACECENTER))
 		{
 			client *p = NULL;
 			// try to center transients on their main window
@@ -688,32 +713,38 @@ void handle_maprequest(XEvent *ev)
 		} else
 		// let program or user specified positions go through, but require it to be neatly on-screen.
 		// client_moveresize() does the necessary nudging
-		if (c->xsize.flags & (PPosition|USPosition))
+		if (c->xsize->flags & (PPosition|USPosition))
 			client_moveresize(c, 0, c->x, c->y, c->w, c->h);
+		request += NextRequest(display) - placing;
 
-		// default to current tag
+		// default to the current tag of the monitor the window opened on
 		client_rules_tags(c);
-		if (!c->cache->tags) client_toggle_tag(c, current_tag, NOFLASH);
-
-		// specifying a non-active monitor will center the window there
-		// this overrides PLACEPOINTER!
-		client_rules_monitor(c);
+		if (!c->cache->tags)
+		{
+			workarea mon; monitor_dimensions_struts(c->x+c->w/2, c->y+c->h/2, &mon);
+			client_toggle_tag(c, monitor_tag(&mon), NOFLASH);
+		}
 
-		// rules may move window again
-		client_rules_moveresize(c);
+		// rules may move window again. specifying a non-active monitor will
+		// center the window there. this overrides PLACEPOINTER!
+		client_rules_geometry(c);
 
 		// must occur after move/resize!
 		client_rules_locks(c);
 
-		// following designed to work after h/v locks
-		client_rules_moveresize_post(c);
+		// post-placement ops are designed to work after h/v locks
+		if (rule) client_rules_ops(c, rule, RULEOP_SNAPRIGHT, RULEOP_VTILE);
 
 		// auto minimizing
-		if (client_rule(c, RULE_MINIMIZE))
+		int minimize = client_rule(c, RULE_MINIMIZE) ? 1: 0;
+		if (minimize) client_minimize(c);
+
+		if (rule)
 		{
-			client_minimize(c);
-			return;
+			rule->xops += NextRequest(display) - request;
+			rule->applied++;
 		}
+		if (minimize) return;
 
 		if (c->trans == None) client_lower(c, 0);
 		XSync(display, False);
@@ -734,9 +765,14 @@ void handle_mapnotify(XEvent *ev)
 		event_client_dump(c);
 	}
 #endif
+	// a panel appearing shrinks the workareas
+	if (c && !c->xattr.override_redirect && c->cache->has_struts)
+		monitor_struts_changed();
+
 	if (c && c->manage && c->visible)
 	{
 		client_set_wm_state(c, NormalState);
+		if (!c->cache->has_mapped) launch_mapped(c->window);
 		client_full_review(c);
 		// dont reapply rules to windows that volantarily unmapped for
 		// some reason, or were explicitly minimized
@@ -797,6 +833,10 @@ void handle_unmapnotify(XEvent *ev)
 {
 	reset_cache_inplay();
 	int was_active = window_is_active(ev->xunmap.window);
+	// the window may be gone already, so go by the cache
+	int idx = winlist_find(windows, ev->xunmap.window);
+	if (idx >= 0 && ((wincache*)windows->data[idx])->has_struts)
+		monitor_struts_changed();
 	client *c = client_create(ev->xunmap.window);
 	// was it a top-level app window that closed?
 	if (c && c->manage)
@@ -817,7 +857,7 @@ void handle_unmapnotify(XEvent *ev)
 			winlist_forget(windows_shaded,    c->window);
 		}
 		// hide border
-		if (c->decorate)
+		if (c->cache->frame)
 			box_hide(c->cache->frame);
 	}
 	// if window has already been destroyed, above client_create() may have failed
@@ -846,7 +886,7 @@ void handle_clientmessage(XEvent *ev)
 	XClientMessageEvent *m = &ev->xclient;
 
 	if (m->message_type == netatoms[_NET_CURRENT_DESKTOP])
-		tag_raise(desktop_to_tag(MAX(0, MIN(TAGS, m->data.l[0]))));
+		tag_raise(desktop_to_tag(MAX(0, MIN(config_tags-1, m->data.l[0]))));
 	else
 	{
 		client *c = client_recreate(m->window);
@@ -897,41 +937,20 @@ void handle_clientmessage(XEvent *ev)
 				}
 			}
 		}
-		// goomwwm cli
-		if (c && (
-			m->message_type == gatoms[GOOMWWM_RESTART] ||
-			m->message_type == gatoms[GOOMWWM_LOG] ||
-			m->message_type == gatoms[GOOMWWM_RULESET] ||
-			m->message_type == gatoms[GOOMWWM_RULE] ||
-			m->message_type == gatoms[GOOMWWM_FIND_OR_START] ||
-			m->message_type == gatoms[GOOMWWM_NOTICE] ||
-			m->message_type == gatoms[GOOMWWM_QUIT]))
+		// goomwwm cli, when the control socket isn't available. see ipc.c
+		int cmd = ipc_command_atom(m->message_type);
+		if (c && cmd >= 0)
 		{
 			event_client_dump(c);
 			char *msg = window_get_text_prop(m->window, gatoms[GOOMWWM_MESSAGE]);
 			event_note("msg: %s", msg);
-			if (msg && m->message_type == gatoms[GOOMWWM_RESTART])
-			{
-				execsh(msg);
-				exit(EXIT_FAILURE);
-			}
-			if (msg && m->message_type == gatoms[GOOMWWM_LOG])
-				fprintf(stderr, "%s\n", msg);
-			if (msg && m->message_type == gatoms[GOOMWWM_RULESET])
-				ruleset_execute(msg);
-			if (msg && m->message_type == gatoms[GOOMWWM_RULE])
-				rule_execute(msg);
-			if (msg && m->message_type == gatoms[GOOMWWM_FIND_OR_START])
-				client_find_or_start(msg);
-			if (m->message_type == gatoms[GOOMWWM_QUIT])
-				exit(EXIT_SUCCESS);
-			if (msg && m->message_type == gatoms[GOOMWWM_NOTICE])
-			{
-				char *notice = msg;
-				// delay in milliseconds is prefixed
-				int delay = strtol(notice, &notice, 10) * 1000;
-				notification(delay ? delay: SAYMS, strtrim(notice));
-			}
+			char *out, *err; size_t outlen, errlen;
+			ipc_run(cmd, msg, &out, &outlen, &err, &errlen);
+			// queries reply via a property on the cli window
+			if (cmd == GOOMWWM_STATS || cmd == GOOMWWM_RESOURCES)
+				window_set_text_prop(m->window, gatoms[cmd], out);
+			if (errlen) fprintf(stderr, "%s", err);
+			free(out); free(err);
 			free(msg);
 		}
 	}
@@ -947,6 +966,20 @@ void handle_propertynotify(XEvent *ev)
 		if (ev->xproperty.atom != atom) { XPutBackEvent(display, ev); break; }
 
 	XPropertyEvent *p = &ev->xproperty;
+	// anything rules match on invalidates the memoised rule
+	if (p->atom == atoms[WM_CLASS] || p->atom == atoms[WM_NAME] || p->atom == netatoms[_NET_WM_NAME]
+		|| p->atom == netatoms[_NET_WM_WINDOW_TYPE] || p->atom == XA_WM_TRANSIENT_FOR)
+	{
+		int idx = winlist_find(windows, p->window);
+		if (idx >= 0)
+		{
+			wincache *cache = windows->data[idx];
+			cache->rule_gen = 0;
+			if (p->atom == atoms[WM_CLASS]) client_forget_strings(cache, DESCRIBED_CLASS);
+			if (p->atom == atoms[WM_NAME] || p->atom == netatoms[_NET_WM_NAME])
+				client_forget_strings(cache, DESCRIBED_TITLE);
+		}
+	}
 	client *c = client_recreate(p->window);
 	if (c && c->visible && c->manage)
 	{
@@ -958,9 +991,20 @@ void handle_propertynotify(XEvent *ev)
 		if (!c->active && c->urgent && (p->atom == XA_WM_HINTS || p->atom == netatoms[_NET_WM_STATE_DEMANDS_ATTENTION]))
 			client_deactivate(c, client_active(0));
 	}
-	// clear monitor workarea/strut cache
+	// workareas follow struts, and the desktop of a window that has them
 	if (p->atom == netatoms[_NET_WM_STRUT] || p->atom == netatoms[_NET_WM_STRUT_PARTIAL])
-		memset(cache_monitor, 0, sizeof(cache_monitor));
+	{
+		int idx = winlist_find(windows, p->window);
+		if (idx >= 0) window_check_struts(p->window, windows->data[idx]);
+		monitor_struts_changed();
+	}
+	else
+	if (p->atom == netatoms[_NET_WM_DESKTOP])
+	{
+		int idx = winlist_find(windows, p->window);
+		if (idx >= 0 && ((wincache*)windows->data[idx])->has_struts)
+			monitor_struts_changed();
+	}
 }
 
 // sloppy focus
@@ -1000,6 +1044,8 @@ void handle_expose(XEvent *ev)
 	event_log("Expose", ev->xany.window);
 	int i; Window w; client *c;
 
+	if (notice_expose(ev->xany.window)) return;
+
 	managed_ascend(i, w, c)
 		if (c->visible && c->decorate
 			&& ((c->cache->frame && c->cache->frame->window == ev->xany.window)
@@ -0,0 +1,283 @@
+/* GoomwWM, Get out of my way, Window Manager!
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// control socket for goomwwm -cli. scripts get results and an exit status back
+// straight away, instead of firing X messages blind and sleeping.
+//
+// request: <command> <length>\n<argument, length bytes>
+// reply:   <status> <out length> <err length>\n<out bytes><err bytes>
+//
+// several requests may share one connection. they are answered in order
+
+// socket path for this display: $XDG_RUNTIME_DIR/goomwwm:0 or /tmp/goomwwm-<uid>:0
+char* ipc_path()
+{
+	static char path[sizeof(((struct sockaddr_un*)0)->sun_path)];
+	char disp[64], *p, *dir = getenv("XDG_RUNTIME_DIR");
+	snprintf(disp, sizeof(disp), "%s", DisplayString(display));
+	// :0 and :0.0 are the same instance
+	if ((p = strrchr(disp, ':')) && (p = strchr(p, '.'))) *p = 0;
+	for (p = disp; *p; p++) if (*p == '/') *p = '_';
+	int n = dir && *dir
+		? snprintf(path, sizeof(path), "%s/goomwwm%s", dir, disp)
+		: snprintf(path, sizeof(path), "/tmp/goomwwm-%d%s", (int)getuid(), disp);
+	return n < sizeof(path) ? path: NULL;
+}
+
+// command name to GOOMWWM_* index, or -1
+int ipc_command(char *name)
+{
+	int i; for (i = 0; i < GATOMS; i++)
+		if (!strcasecmp(name, gatom_names[i] + IPCPREFIX)) return i;
+	return -1;
+}
+
+// X message type to GOOMWWM_* index, or -1
+int ipc_command_atom(Atom atom)
+{
+	int i; for (i = 0; i < GATOMS; i++)
+		if (gatoms[i] == atom) return i;
+	return -1;
+}
+
+// write all or nothing. never blocks the wm on a slow reader
+int ipc_send(int fd, char *buf, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t n = send(fd, buf, len, MSG_NOSIGNAL | (fd == ipc_current ? MSG_DONTWAIT: 0));
+		if (n < 0 && errno == EINTR) continue;
+		if (n <= 0) return 0;
+		buf += n; len -= n;
+	}
+	return 1;
+}
+
+int ipc_reply(int fd, int status, char *out, size_t outlen, char *err, size_t errlen)
+{
+	char head[64];
+	snprintf(head, sizeof(head), "%d %lu %lu\n", status, (unsigned long)outlen, (unsigned long)errlen);
+	return ipc_send(fd, head, strlen(head)) && ipc_send(fd, out, outlen) && ipc_send(fd, err, errlen);
+}
+
+// acknowledge the current socket request early, for commands that never return
+void ipc_ack()
+{
+	if (ipc_current >= 0) ipc_reply(ipc_current, EXIT_SUCCESS, empty, 0, empty, 0);
+}
+
+// run one cli command, from the socket or an X message. output goes to out, complaints
+// to err. returns an exit status
+int ipc_execute(int cmd, char *msg, FILE *out, FILE *err)
+{
+	if (!msg && (cmd == GOOMWWM_RESTART || cmd == GOOMWWM_EXEC || cmd == GOOMWWM_LOG || cmd == GOOMWWM_RULESET
+		|| cmd == GOOMWWM_RULE || cmd == GOOMWWM_FIND_OR_START || cmd == GOOMWWM_NOTICE))
+	{
+		fprintf(err, "missing argument\n");
+		return EXIT_FAILURE;
+	}
+	switch (cmd)
+	{
+		// only another goomwwm can read the snapshot. a different wm started by -exec
+		// must not leave one on root for some later goomwwm to apply to recycled ids
+		case GOOMWWM_RESTART:
+		case GOOMWWM_EXEC:
+			ipc_ack();
+			if (cmd == GOOMWWM_RESTART) snapshot_save();
+			loop_unblock();
+			execsh(msg);
+			exit(EXIT_FAILURE);
+		case GOOMWWM_QUIT:
+			ipc_ack();
+			exit(EXIT_SUCCESS);
+		case GOOMWWM_LOG:
+			fprintf(stderr, "%s\n", msg);
+			break;
+		case GOOMWWM_RULESET:
+			if (!ruleset_execute(msg))
+			{
+				fprintf(err, "no such ruleset: %s\n", msg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case GOOMWWM_RULE:
+			if (!rule_execute(msg))
+			{
+				fprintf(err, "invalid rule: %s\n", msg);
+				return EXIT_FAILURE;
+			}
+			break;
+		case GOOMWWM_FIND_OR_START:
+			fprintf(out, "%s\n", client_find_or_start(msg) ? "found": "started");
+			break;
+		case GOOMWWM_NOTICE:
+		{
+			char *notice = msg;
+			// delay in seconds is prefixed
+			int delay = strtol(notice, &notice, 10) * 1000;
+			notification(delay ? delay: SAYMS, strtrim(notice));
+			break;
+		}
+		case GOOMWWM_RELOAD:
+			wm_reload();
+			break;
+		case GOOMWWM_STATS:
+			loop_dump(out);
+			break;
+		case GOOMWWM_RESOURCES:
+			// non-zero when anything is flagged as growing
+			return account_dump(out) ? EXIT_FAILURE: EXIT_SUCCESS;
+		default:
+			fprintf(err, "unknown command: %s\n", gatom_names[cmd] + IPCPREFIX);
+			return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
+
+// ipc_execute() into strings. caller frees out and err
+int ipc_run(int cmd, char *msg, char **out, size_t *outlen, char **err, size_t *errlen)
+{
+	*out = NULL; *err = NULL;
+	FILE *fo = open_memstream(out, outlen), *fe = open_memstream(err, errlen);
+	int status = ipc_execute(cmd, msg, fo, fe);
+	fclose(fo); fclose(fe);
+	return status;
+}
+
+void ipc_close(winipc *p)
+{
+	loop_remove(p->fd);
+	close(p->fd);
+	free(p->buf);
+	memset(p, 0, sizeof(winipc));
+	p->fd = -1;
+}
+
+// answer one request. false if the reply could not be sent
+int ipc_request(winipc *p, char *name, char *arg)
+{
+	char *out, *err; size_t outlen, errlen; int status, cmd = ipc_command(name);
+	ipc_current = p->fd;
+	if (cmd < 0)
+	{
+		FILE *fe = open_memstream(&err, &errlen);
+		fprintf(fe, "unknown command: %s\n", name); fclose(fe);
+		out = strdup(empty); outlen = 0;
+		status = EXIT_FAILURE;
+	}
+	else status = ipc_run(cmd, arg, &out, &outlen, &err, &errlen);
+	int ok = ipc_reply(p->fd, status, out, outlen, err, errlen);
+	ipc_current = -1;
+	free(out); free(err);
+	return ok;
+}
+
+// connection readable. buffer input and answer each complete frame. a client may
+// send everything and close its end at once, so frames already read are answered
+// before an EOF closes the connection
+void ipc_read(int fd, void *data)
+{
+	winipc *p = data; int eof = 0, broken = 0, off = 0; ssize_t n;
+	for (;;)
+	{
+		if (p->size - p->len < IPCCHUNK)
+			p->buf = reallocate(p->buf, (p->size += IPCCHUNK) + 1);
+		n = read(fd, p->buf + p->len, IPCCHUNK);
+		if (n > 0) { p->len += n; if (p->len > IPCMAX) { broken = 1; break; } continue; }
+		if (n == 0 || (errno != EAGAIN && errno != EINTR)) eof = 1;
+		break;
+	}
+	char *nl;
+	while (!broken)
+	{
+		// tolerate blank lines between frames, for hand written requests
+		while (off < p->len && isspace(p->buf[off])) off++;
+		if (!(nl = memchr(p->buf + off, '\n', p->len - off))) break;
+		char name[32]; int len = -1;
+		*nl = 0;
+		if (sscanf(p->buf + off, "%31s %d", name, &len) != 2 || len < 0 || len > IPCMAX)
+			{ broken = 1; break; }
+		// wait for the rest of the argument
+		if (nl + 1 + len > p->buf + p->len) { *nl = '\n'; break; }
+		char *arg = len ? strndup(nl + 1, len): NULL;
+		if (!ipc_request(p, name, arg)) broken = 1;
+		free(arg);
+		off = nl + 1 + len - p->buf;
+	}
+	// any partial frame left at EOF can never complete
+	if (eof || broken) { ipc_close(p); return; }
+	memmove(p->buf, p->buf + off, p->len - off);
+	p->len -= off;
+}
+
+void ipc_accept(int fd, void *data)
+{
+	int i, c = accept(fd, NULL, NULL);
+	if (c < 0) return;
+	fcntl(c, F_SETFD, FD_CLOEXEC);
+	fcntl(c, F_SETFL, O_NONBLOCK);
+	for (i = 0; i < IPCCONNS && ipc_conns[i].fd >= 0; i++);
+	if (i == IPCCONNS) { close(c); return; }
+	ipc_conns[i].fd = c;
+	if (!loop_add(c, ipc_read, &ipc_conns[i])) ipc_close(&ipc_conns[i]);
+}
+
+// children run atexit handlers too, if exec fails
+void ipc_cleanup()
+{
+	char *path = ipc_path();
+	if (getpid() == ipc_pid && path) unlink(path);
+}
+
+// listen on the control socket. without it -cli falls back to X messages
+void ipc_setup()
+{
+	int i; char *path = ipc_path();
+	for (i = 0; i < IPCCONNS; i++) ipc_conns[i].fd = -1;
+	if (!path) return;
+	struct sockaddr_un sa; memset(&sa, 0, sizeof(sa));
+	sa.sun_family = AF_UNIX;
+	strcpy(sa.sun_path, path);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) { warn("control socket"); return; }
+	fcntl(fd, F_SETFD, FD_CLOEXEC);
+	fcntl(fd, F_SETFL, O_NONBLOCK);
+	// a live instance would have failed SubstructureRedirect by now, so this is stale
+	unlink(path);
+	mode_t mask = umask(0077);
+	int ok = bind(fd, (struct sockaddr*)&sa, sizeof(sa)) == 0 && listen(fd, IPCCONNS) == 0;
+	umask(mask);
+	if (!ok || !loop_add(fd, ipc_accept, NULL))
+	{
+		warn("%s", path);
+		close(fd);
+		return;
+	}
+	ipc_listen = fd;
+	ipc_pid = getpid();
+	atexit(ipc_cleanup);
+}
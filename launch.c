@@ -0,0 +1,165 @@
+/* GoomwWM, Get out of my way, Window Manager!
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// start commands with posix_spawn, so the window manager is never duplicated,
+// and time how long each takes to map its first window
+
+// characters that need /bin/sh to make sense of a command line
+#define LAUNCH_SHELL "\"'`\\$&|;<>()[]{}*?~!#=%\n"
+
+// split a plain command line on whitespace. returns NULL if it needs a shell
+char** launch_argv(char *cmd)
+{
+	int n = 0; char **argv, *p, *tok, *save = NULL;
+	if (strpbrk(cmd, LAUNCH_SHELL)) return NULL;
+	for (p = cmd; *p; p++)
+		if (!isspace(*p) && (p == cmd || isspace(p[-1]))) n++;
+	if (!n) return NULL;
+	argv = allocate_clear(sizeof(char*) * (n+1) + strlen(cmd) + 1);
+	p = strcpy((char*)&argv[n+1], cmd);
+	for (n = 0; (tok = strtok_r(p, " \t\v\f\r", &save)); p = NULL)
+		argv[n++] = tok;
+	return argv;
+}
+
+// child environment with our startup id replacing any inherited one
+char** launch_environ(char *id)
+{
+	int i, n = 0; char **env;
+	for (i = 0; environ[i]; i++);
+	env = allocate_clear(sizeof(char*) * (i+2));
+	for (i = 0; environ[i]; i++)
+		if (strncmp(environ[i], "DESKTOP_STARTUP_ID=", 19))
+			env[n++] = environ[i];
+	env[n] = id;
+	return env;
+}
+
+// find a slot for a new launch, retiring any that never mapped
+winlaunch* launch_slot()
+{
+	int i, oldest = 0; double now = timestamp();
+	for (i = 0; i < LAUNCHES; i++)
+	{
+		if (launches[i].active && (now - launches[i].started) * 1000 > LAUNCHMS)
+		{
+			launches[i].active = 0;
+			launch_totals.expired++;
+		}
+		if (launches[i].started < launches[oldest].started) oldest = i;
+	}
+	for (i = 0; i < LAUNCHES && launches[i].active; i++);
+	if (i == LAUNCHES)
+	{
+		i = oldest;
+		launch_totals.expired++;
+	}
+	return &launches[i];
+}
+
+// execute sub-process. simple commands skip the shell
+pid_t exec_cmd(char *cmd)
+{
+	pid_t pid; int rc; char id[96], **argv, **env;
+	char *shell[] = { "sh", "-c", cmd, NULL };
+	if (!cmd || !cmd[0]) return -1;
+
+	winlaunch *l = launch_slot();
+	snprintf(l->id, sizeof(l->id), "goomwwm-%d-%u_TIME%lu", getpid(), ++launch_serial, (unsigned long)latest);
+	snprintf(id, sizeof(id), "DESKTOP_STARTUP_ID=%s", l->id);
+	env = launch_environ(id);
+
+	// new session, default signal handling, and none of our blocked signals
+	posix_spawnattr_t attr;
+	posix_spawnattr_init(&attr);
+	short flags = POSIX_SPAWN_SETSIGMASK|POSIX_SPAWN_SETSIGDEF;
+#ifdef POSIX_SPAWN_SETSID
+	flags |= POSIX_SPAWN_SETSID;
+#else
+	flags |= POSIX_SPAWN_SETPGROUP;
+	posix_spawnattr_setpgroup(&attr, 0);
+#endif
+	posix_spawnattr_setflags(&attr, flags);
+	posix_spawnattr_setsigmask(&attr, &loop_oldmask);
+	posix_spawnattr_setsigdefault(&attr, &loop_sigmask);
+
+	if ((argv = launch_argv(cmd)))
+		rc = posix_spawnp(&pid, argv[0], NULL, &attr, argv, env);
+	else
+		rc = posix_spawn(&pid, "/bin/sh", NULL, &attr, shell, env);
+
+	posix_spawnattr_destroy(&attr);
+	free(argv); free(env);
+
+	if (rc)
+	{
+		fprintf(stderr, "cannot launch %s: %s\n", cmd, strerror(rc));
+		launch_totals.failed++;
+		return -1;
+	}
+	l->pid = pid;
+	l->started = timestamp();
+	l->active = 1;
+	launch_totals.spawned++;
+	return pid;
+}
+
+// first MapNotify of a managed window. match it to a launch by startup id, then pid
+void launch_mapped(Window w)
+{
+	int i; unsigned long pid = 0; winlaunch *l = NULL;
+	for (i = 0; i < LAUNCHES && !launches[i].active; i++);
+	if (i == LAUNCHES) return;
+
+	char *id = window_get_text_prop(w, netatoms[_NET_STARTUP_ID]);
+	if (id) for (i = 0; i < LAUNCHES && !l; i++)
+		if (launches[i].active && !strcmp(launches[i].id, id)) l = &launches[i];
+	free(id);
+
+	if (!l && window_get_cardinal_prop(w, netatoms[_NET_WM_PID], &pid, 1))
+		for (i = 0; i < LAUNCHES && !l; i++)
+			if (launches[i].active && launches[i].pid == (pid_t)pid) l = &launches[i];
+	if (!l) return;
+
+	double ms = (timestamp() - l->started) * 1000;
+	l->active = 0;
+	launch_totals.last = ms;
+	launch_totals.total += ms;
+	launch_totals.min = launch_totals.mapped ? MIN(launch_totals.min, ms): ms;
+	launch_totals.max = MAX(launch_totals.max, ms);
+	launch_totals.mapped++;
+}
+
+void launch_dump(FILE *f)
+{
+	int i, pending = 0;
+	for (i = 0; i < LAUNCHES; i++) if (launches[i].active) pending++;
+	fprintf(f, "launches: %u spawned, %u failed, %u mapped, %u unmapped, %d pending\n",
+		launch_totals.spawned, launch_totals.failed, launch_totals.mapped, launch_totals.expired, pending);
+	if (launch_totals.mapped)
+		fprintf(f, "launch latency: last %.0fms, min %.0fms, avg %.0fms, max %.0fms\n",
+			launch_totals.last, launch_totals.min, launch_totals.total / launch_totals.mapped, launch_totals.max);
+}
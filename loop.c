@@ -0,0 +1,212 @@
+/* GoomwWM, Get out of my way, Window Manager!
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// the main event loop waits here for X, timers, signals and any extra descriptors.
+// signals are blocked and collected synchronously, so nothing runs in handler context
+
+#ifndef __linux__
+void loop_catch(int sig)
+{
+	loop_caught |= 1 << sig;
+}
+#endif
+
+// restore the signal mask we started with. call before exec in child processes
+void loop_unblock()
+{
+	sigprocmask(SIG_SETMASK, &loop_oldmask, NULL);
+}
+
+// SIGUSR1 diagnostics, and the cli -stats reply
+void loop_dump(FILE *f)
+{
+	int i, timed = 0, flashing = 0, noticing = 0, fds = 0;
+	for (i = 0; i < TIMERS; i++) if (timers[i].callback) timed++;
+	for (i = 0; i < FLASHES; i++) if (flashes[i].active) flashing++;
+	for (i = 0; i < NOTICES; i++) if (notices[i].active) noticing++;
+	for (i = 0; i < LOOPFDS; i++) if (loop_fds[i].callback) fds++;
+
+	fprintf(f, "goomwwm %s pid %d\n", VERSION, getpid());
+	fprintf(f, "windows: %d tracked, %d activated, %d minimized, %d shaded\n",
+		windows->len, windows_activated->len, windows_minimized->len, windows_shaded->len);
+	fprintf(f, "timers: %d pending, next %dms\n", timed, timer_next());
+	fprintf(f, "flashes: %d, notices: %d, spare frames: %d, menu: %s, fds: %d\n",
+		flashing, noticing, frame_pooled, menu_active ? "open": "closed", fds);
+	fprintf(f, "memory: client arena %lu bytes in %lu blocks, %lu allocs, %lu resets; heap allocs %lu; spare lists %d; interned strings %d\n",
+		arena_used(&client_arena), client_arena.blocks, client_arena.allocs, client_arena.resets, heap_allocs, winlist_pooled, interned_strings);
+	launch_dump(f);
+	rule_dump(f);
+	account_dump(f);
+}
+
+void loop_handle_signal(int sig)
+{
+	if (sig == SIGCHLD) catch_exit(sig);
+	if (sig == SIGHUP)  wm_reload();
+	if (sig == SIGUSR1) loop_dump(stderr);
+}
+
+#ifdef __linux__
+void loop_watch(int fd, int add)
+{
+	struct epoll_event ev; memset(&ev, 0, sizeof(ev));
+	ev.events = EPOLLIN; ev.data.fd = fd;
+	epoll_ctl(loop_poll, add ? EPOLL_CTL_ADD: EPOLL_CTL_DEL, fd, &ev);
+}
+#endif
+
+// watch an extra descriptor. callback runs from the main loop when it is readable
+int loop_add(int fd, loop_callback callback, void *data)
+{
+	int i; for (i = 0; i < LOOPFDS && loop_fds[i].callback; i++);
+	if (i == LOOPFDS)
+	{
+		fprintf(stderr, "too many loop fds!\n");
+		return 0;
+	}
+	loop_fds[i].fd = fd;
+	loop_fds[i].callback = callback;
+	loop_fds[i].data = data;
+#ifdef __linux__
+	loop_watch(fd, 1);
+#endif
+	return 1;
+}
+
+void loop_remove(int fd)
+{
+	int i; for (i = 0; i < LOOPFDS; i++)
+	{
+		if (loop_fds[i].callback && loop_fds[i].fd == fd)
+		{
+			loop_fds[i].callback = NULL;
+#ifdef __linux__
+			loop_watch(fd, 0);
+#endif
+		}
+	}
+}
+
+void loop_ready(int fd)
+{
+	int i; for (i = 0; i < LOOPFDS; i++)
+		if (loop_fds[i].callback && loop_fds[i].fd == fd)
+			loop_fds[i].callback(fd, loop_fds[i].data);
+}
+
+// block our signals and build the wait set. call once, before forking anything
+void loop_setup(char **argv)
+{
+	loop_argv = argv;
+	sigemptyset(&loop_sigmask);
+	sigaddset(&loop_sigmask, SIGCHLD);
+	sigaddset(&loop_sigmask, SIGHUP);
+	sigaddset(&loop_sigmask, SIGUSR1);
+	sigprocmask(SIG_BLOCK, &loop_sigmask, &loop_oldmask);
+#ifdef __linux__
+	loop_poll   = epoll_create1(EPOLL_CLOEXEC);
+	loop_timer  = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK|TFD_CLOEXEC);
+	loop_signal = signalfd(-1, &loop_sigmask, SFD_NONBLOCK|SFD_CLOEXEC);
+	if (loop_poll < 0 || loop_timer < 0 || loop_signal < 0)
+		err(EXIT_FAILURE, "event loop");
+	loop_watch(ConnectionNumber(display), 1);
+	loop_watch(loop_timer, 1);
+	loop_watch(loop_signal, 1);
+#else
+	// handlers only run inside pselect(), which unblocks them atomically
+	struct sigaction sa; memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = loop_catch;
+	sigaction(SIGCHLD, &sa, NULL);
+	sigaction(SIGHUP,  &sa, NULL);
+	sigaction(SIGUSR1, &sa, NULL);
+#endif
+}
+
+// block until X has events queued, running timers, signals and fd callbacks as they
+// fall due. returns true if there are X events to process
+int loop_wait()
+{
+	int i, n, ms, xfd = ConnectionNumber(display);
+
+	timer_run();
+	if (XPending(display)) return 1;
+	ms = timer_next();
+
+#ifdef __linux__
+	// arm the timerfd for the next wheel deadline, or disarm it. no idle wakeups
+	struct itimerspec its; memset(&its, 0, sizeof(its));
+	if (ms >= 0)
+	{
+		its.it_value.tv_sec  = ms / 1000;
+		its.it_value.tv_nsec = ms ? (ms % 1000) * 1000000: 1;
+	}
+	timerfd_settime(loop_timer, 0, &its, NULL);
+
+	struct epoll_event evs[LOOPFDS+3];
+	n = epoll_wait(loop_poll, evs, LOOPFDS+3, -1);
+
+	for (i = 0; i < n; i++)
+	{
+		int fd = evs[i].data.fd;
+		if (fd == loop_timer)
+		{
+			unsigned long long expired;
+			while (read(loop_timer, &expired, sizeof(expired)) > 0);
+		}
+		else
+		if (fd == loop_signal)
+		{
+			struct signalfd_siginfo si;
+			while (read(loop_signal, &si, sizeof(si)) == sizeof(si))
+				loop_handle_signal(si.ssi_signo);
+		}
+		else
+		if (fd != xfd) loop_ready(fd);
+	}
+#else
+	fd_set fds; FD_ZERO(&fds); FD_SET(xfd, &fds);
+	int max = xfd;
+	for (i = 0; i < LOOPFDS; i++)
+	{
+		if (!loop_fds[i].callback) continue;
+		FD_SET(loop_fds[i].fd, &fds);
+		max = MAX(max, loop_fds[i].fd);
+	}
+	struct timespec ts = { ms / 1000, (ms % 1000) * 1000000 };
+	n = pselect(max+1, &fds, NULL, NULL, ms < 0 ? NULL: &ts, &loop_oldmask);
+
+	int caught = loop_caught; loop_caught = 0;
+	for (i = 1; i < 32; i++)
+		if (caught & (1 << i)) loop_handle_signal(i);
+
+	for (i = 0; n > 0 && i < LOOPFDS; i++)
+		if (loop_fds[i].callback && FD_ISSET(loop_fds[i].fd, &fds))
+			loop_ready(loop_fds[i].fd);
+#endif
+
+	timer_run();
+	return XPending(display) ?1:0;
+}
@@ -24,228 +24,209 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 */
 
-void menu_draw(textbox *text, textbox **boxes, int max_lines, int selected, char **filtered)
+// popup menus run inside the main event loop. menu() maps the window and returns
+// immediately; menu_event() consumes events for it, and the callback fires on close
+
+void menu_draw(struct localmenu *m)
 {
 	int i;
-	textbox_draw(text);
-	for (i = 0; i < max_lines; i++)
+	textbox_draw(m->text);
+	for (i = 0; i < m->max_lines; i++)
 	{
-		textbox_font(boxes[i], config_menu_font,
-			i == selected ? config_menu_hlfg: config_menu_fg,
-			i == selected ? config_menu_hlbg: config_menu_bg);
-		textbox_text(boxes[i], filtered[i] ? filtered[i]: "");
-		textbox_draw(boxes[i]);
+		textbox_font(m->boxes[i], config_menu_font,
+			i == m->selected ? config_menu_hlfg: config_menu_fg,
+			i == m->selected ? config_menu_hlbg: config_menu_bg);
+		textbox_text(m->boxes[i], m->filtered[i] ? m->filtered[i]: "");
+		textbox_draw(m->boxes[i]);
 	}
 }
 
-int menu(char **lines, char **input, char *prompt, int selected)
+// close the active menu. callback gets the chosen line and its text, or -1 and
+// whatever was typed. escape passes -1 and NULL
+void menu_close(int chosen)
+{
+	int i, line = -1; char *text = NULL;
+	struct localmenu *m = menu_active;
+	if (!m) return;
+
+	menu_active = NULL;
+	release_keyboard();
+	XUnmapWindow(display, m->window);
+
+	if (chosen && m->max_lines && m->filtered[m->selected])
+		line = m->line_map[m->selected];
+
+	if (line >= 0) text = m->lines[line];
+	else if (chosen) text = m->text->text;
+
+	// selected windows may have changed or gone away while the menu was open
+	reset_lazy_caches();
+	reset_cache_client();
+	if (m->callback) m->callback(line, text, m->data);
+
+	textbox_free(m->text);
+	for (i = 0; i < m->max_lines; i++)
+		textbox_free(m->boxes[i]);
+	XDestroyWindow(display, m->window);
+	account(ACCOUNT_windows, -1);
+	for (i = 0; i < m->num_lines; i++)
+		free(m->lines[i]);
+	free(m->lines);
+	free(m->boxes);
+	free(m->filtered);
+	free(m->line_map);
+	free(m);
+}
+
+void menu_cancel()
+{
+	menu_close(0);
+}
+
+// open a filterable menu. takes ownership of the NULL terminated lines
+void menu(char **lines, char *prompt, int selected, menu_callback callback, void *data)
 {
-	int line = -1, i, j, chosen = 0;
+	int i;
 	workarea mon; monitor_active(&mon);
 
-	int num_lines = 0; for (; lines[num_lines]; num_lines++);
-	int max_lines = MIN(config_menu_lines, num_lines);
-	selected = MAX(MIN(num_lines-1, selected), 0);
+	// one at a time
+	if (menu_active) menu_close(0);
+
+	struct localmenu *m = allocate_clear(sizeof(struct localmenu));
+	m->lines = lines;
+	m->callback = callback;
+	m->data = data;
+
+	for (; lines[m->num_lines]; m->num_lines++);
+	m->max_lines = MIN(config_menu_lines, m->num_lines);
+	m->selected = MAX(MIN(m->num_lines-1, selected), 0);
 
 	int w = config_menu_width < 101 ? (mon.w/100)*config_menu_width: config_menu_width;
 	int x = mon.x + (mon.w - w)/2;
 
-	Window box = XCreateSimpleWindow(display, root, x, 0, w, 300, 1, color_get(config_menu_bc), color_get(config_menu_bg));
-	XSelectInput(display, box, ExposureMask);
+	m->window = XCreateSimpleWindow(display, root, x, 0, w, 300, 1, color_get(config_menu_bc), color_get(config_menu_bg));
+	account(ACCOUNT_windows, 1);
+	XSelectInput(display, m->window, ExposureMask);
 
 	// make it an unmanaged window
-	window_set_atom_prop(box, netatoms[_NET_WM_STATE], &netatoms[_NET_WM_STATE_ABOVE], 1);
-	window_set_atom_prop(box, netatoms[_NET_WM_WINDOW_TYPE], &netatoms[_NET_WM_WINDOW_TYPE_DOCK], 1);
+	window_set_atom_prop(m->window, netatoms[_NET_WM_STATE], &netatoms[_NET_WM_STATE_ABOVE], 1);
+	window_set_atom_prop(m->window, netatoms[_NET_WM_WINDOW_TYPE], &netatoms[_NET_WM_WINDOW_TYPE_DOCK], 1);
 
 	// search text input
-	textbox *text = textbox_create(box, TB_AUTOHEIGHT|TB_EDITABLE, 5, 5, w-10, 1,
+	m->text = textbox_create(m->window, TB_AUTOHEIGHT|TB_EDITABLE, 5, 5, w-10, 1,
 		config_menu_font, config_menu_fg, config_menu_bg, "", prompt);
-	textbox_show(text);
+	textbox_show(m->text);
 
-	int line_height = text->font->ascent + text->font->descent;
+	int line_height = m->text->font->ascent + m->text->font->descent;
 	int row_padding = line_height/10;
 	int row_height = line_height + row_padding;
 
 	// filtered list display
-	textbox **boxes = allocate_clear(sizeof(textbox*) * max_lines);
+	m->boxes = allocate_clear(sizeof(textbox*) * m->max_lines);
 
-	for (i = 0; i < max_lines; i++)
+	for (i = 0; i < m->max_lines; i++)
 	{
-		boxes[i] = textbox_create(box, TB_AUTOHEIGHT, 5, (i+1) * row_height + 5, w-10, 1,
+		m->boxes[i] = textbox_create(m->window, TB_AUTOHEIGHT, 5, (i+1) * row_height + 5, w-10, 1,
 			config_menu_font, config_menu_fg, config_menu_bg, lines[i], NULL);
-		textbox_show(boxes[i]);
+		textbox_show(m->boxes[i]);
 	}
 
 	// filtered list
-	char **filtered = allocate_clear(sizeof(char*) * max_lines);
-	int *line_map = allocate_clear(sizeof(int) * max_lines);
-	int filtered_lines = max_lines;
+	m->filtered = allocate_clear(sizeof(char*) * m->max_lines);
+	m->line_map = allocate_clear(sizeof(int) * m->max_lines);
+	m->filtered_lines = m->max_lines;
 
-	for (i = 0; i < max_lines; i++)
+	for (i = 0; i < m->max_lines; i++)
 	{
-		filtered[i] = lines[i];
-		line_map[i] = i;
+		m->filtered[i] = lines[i];
+		m->line_map[i] = i;
 	}
 
 	// resize window vertically to suit
-	int h = row_height * (max_lines+1) + 10 - row_padding;
+	int h = row_height * (m->max_lines+1) + 10 - row_padding;
 	int y = mon.y + (mon.h - h)/2;
-	XMoveResizeWindow(display, box, x, y, w, h);
-	XMapRaised(display, box);
-
-	take_keyboard(box);
-	for (;;)
-	{
-		XEvent ev;
-		XNextEvent(display, &ev);
+	XMoveResizeWindow(display, m->window, x, y, w, h);
+	XMapRaised(display, m->window);
 
-		if (ev.type == Expose)
-		{
-			while (XCheckTypedEvent(display, Expose, &ev));
-			menu_draw(text, boxes, max_lines, selected, filtered);
-		}
-		else
-		if (ev.type == KeyPress)
-		{
-			while (XCheckTypedEvent(display, KeyPress, &ev));
-			latest = ev.xkey.time;
-
-			int rc = textbox_keypress(text, &ev);
-			if (rc < 0)
-			{
-				chosen = 1;
-				break;
-			}
-			else
-			if (rc)
-			{
-				// input changed
-				for (i = 0, j = 0; i < num_lines && j < max_lines; i++)
-				{
-					if (strcasestr(lines[i], text->text))
-					{
-						line_map[j] = i;
-						filtered[j++] = lines[i];
-					}
-				}
-				filtered_lines = j;
-				selected = MAX(0, MIN(selected, j-1));
-				for (; j < max_lines; j++)
-					filtered[j] = NULL;
-			}
-			else
-			{
-				// unhandled key
-				KeySym key = XkbKeycodeToKeysym(display, ev.xkey.keycode, 0, 0);
-
-				if (key == XK_Escape)
-					break;
-
-				if (key == XK_Up)
-					selected = selected ? MAX(0, selected-1): MAX(0, filtered_lines-1);
-
-				if (key == XK_Down || key == XK_Tab || key == XK_grave)
-					selected = selected < filtered_lines-1 ? MIN(filtered_lines-1, selected+1): 0;
-			}
-			menu_draw(text, boxes, max_lines, selected, filtered);
-		}
-
-		// check for modkeyup mode
-		if (config_menu_select == MENUMODUP && !modkey_is_down())
-		{
-			chosen = 1;
-			break;
-		}
-	}
-	release_keyboard();
-
-	if (chosen && filtered[selected])
-		line = line_map[selected];
-
-	if (line < 0 && input)
-		*input = strdup(text->text);
-
-	textbox_free(text);
-	for (i = 0; i < max_lines; i++)
-		textbox_free(boxes[i]);
-	XDestroyWindow(display, box);
-	free(filtered);
-	free(line_map);
-
-	return line;
+	menu_active = m;
+	take_keyboard(m->window, menu_cancel);
 }
 
 // simple little text input prompt based on menu
-// really needs a title, or perhaps optional "prompt text>"
-char* prompt(char *ps)
+void prompt(char *ps, menu_callback callback, void *data)
 {
-	char *input = NULL;
-
-	workarea mon; monitor_active(&mon);
-
-	int w = config_menu_width < 101 ? (mon.w/100)*config_menu_width: config_menu_width;
-	int x = mon.x + (mon.w - w)/2;
-
-	Window box = XCreateSimpleWindow(display, root, x, 0, w, 300, 1, color_get(config_menu_bc), color_get(config_menu_bg));
-	XSelectInput(display, box, ExposureMask);
-
-	// make it an unmanaged window
-	window_set_atom_prop(box, netatoms[_NET_WM_STATE], &netatoms[_NET_WM_STATE_ABOVE], 1);
-	window_set_atom_prop(box, netatoms[_NET_WM_WINDOW_TYPE], &netatoms[_NET_WM_WINDOW_TYPE_DOCK], 1);
-
-	// textbox
-	textbox *text = textbox_create(box, TB_EDITABLE|TB_AUTOHEIGHT, 5, 5, w-10, 1, config_menu_font, config_menu_fg, config_menu_bg, "", ps);
+	menu(allocate_clear(sizeof(char*)), ps, 0, callback, data);
+}
 
-	// textbox has computed line height for the supplied font
-	// resize window vertically to suit
-	int h = text->h + 10;
-	int y = mon.y + (mon.h - h)/2;
-	XMoveResizeWindow(display, box, x, y, w, h);
+// prompt callback to run whatever was typed
+void prompt_exec(int line, char *text, void *data)
+{
+	if (text && *text) exec_cmd(text);
+}
 
-	textbox_show(text);
-	XMapRaised(display, box);
+// handle an event for the active menu. returns 1 if consumed
+int menu_event(XEvent *ev)
+{
+	int i, j;
+	struct localmenu *m = menu_active;
+	if (!m || ev->xany.window != m->window) return 0;
 
-	take_keyboard(box);
-	for (;;)
+	if (ev->type == Expose)
+	{
+		while (XCheckTypedWindowEvent(display, m->window, Expose, ev));
+		menu_draw(m);
+	}
+	else
+	if (ev->type == KeyPress)
 	{
-		XEvent ev;
-		XNextEvent(display, &ev);
+		latest = ev->xkey.time;
 
-		if (ev.type == Expose)
+		int rc = textbox_keypress(m->text, ev);
+		if (rc < 0)
 		{
-			while (XCheckTypedEvent(display, Expose, &ev));
-			textbox_draw(text);
+			menu_close(1);
+			return 1;
 		}
 		else
-		if (ev.type == KeyPress)
+		if (rc)
 		{
-			while (XCheckTypedEvent(display, KeyPress, &ev));
-
-			int rc = textbox_keypress(text, &ev);
-			if (rc < 0)
-			{
-				// text entered
-				input = strdup(text->text);
-				break;
-			}
-			else
-			if (rc)
+			// input changed
+			for (i = 0, j = 0; i < m->num_lines && j < m->max_lines; i++)
 			{
-				// selection changed
-				textbox_draw(text);
+				if (strcasestr(m->lines[i], m->text->text))
+				{
+					m->line_map[j] = i;
+					m->filtered[j++] = m->lines[i];
+				}
 			}
-			else
+			m->filtered_lines = j;
+			m->selected = MAX(0, MIN(m->selected, j-1));
+			for (; j < m->max_lines; j++)
+				m->filtered[j] = NULL;
+		}
+		else
+		{
+			// unhandled key
+			KeySym key = XkbKeycodeToKeysym(display, ev->xkey.keycode, 0, 0);
+
+			if (key == XK_Escape)
 			{
-				// unhandled key
-				KeySym key = XkbKeycodeToKeysym(display, ev.xkey.keycode, 0, 0);
-				if (key == XK_Escape) break;
+				menu_close(0);
+				return 1;
 			}
+
+			if (key == XK_Up)
+				m->selected = m->selected ? MAX(0, m->selected-1): MAX(0, m->filtered_lines-1);
+
+			if (key == XK_Down || key == XK_Tab || key == XK_grave)
+				m->selected = m->selected < m->filtered_lines-1 ? MIN(m->filtered_lines-1, m->selected+1): 0;
 		}
+		menu_draw(m);
 	}
-	release_keyboard();
 
-	textbox_free(text);
-	XDestroyWindow(display, box);
+	// check for modkeyup mode
+	if (config_menu_select == MENUMODUP && !modkey_is_down())
+		menu_close(1);
 
-	return input;
+	return 1;
 }
@@ -45,6 +45,7 @@ void monitor_dimensions(int x, int y, workarea *mon)
 				{
 					mon->x = info[i].x_org; mon->y = info[i].y_org;
 					mon->w = info[i].width; mon->h = info[i].height;
+					mon->n = i;
 					break;
 				}
 			}
@@ -53,7 +54,32 @@ void monitor_dimensions(int x, int y, workarea *mon)
 	}
 }
 
-// find the dimensions, EXCLUDING STRUTS, of the monitor displaying point x,y
+// shrink a monitor by root-relative strut sizes
+void monitor_apply_struts(workarea *mon, int left, int right, int top, int bottom)
+{
+	// strut cardinals are relative to the root window size, which is not necessarily the monitor size
+	XWindowAttributes *rattr = window_get_attributes(root);
+	// limit struts on any side to 1/3 monitor size
+	mon->l = MIN(mon->w/3, MAX(0, left-mon->x));
+	mon->r = MIN(mon->w/3, MAX(0, (mon->x+mon->w)-(rattr->width-right)));
+	mon->t = MIN(mon->h/3, MAX(0, top-mon->y));
+	mon->b = MIN(mon->h/3, MAX(0, (mon->y+mon->h)-(rattr->height-bottom)));
+	mon->x += mon->l; mon->y += mon->t;
+	mon->w -= (mon->l+mon->r);
+	mon->h -= (mon->t+mon->b);
+}
+
+// a panel mapped, unmapped, or changed its struts or desktop. drop the cached
+// workareas and advertise new ones
+void monitor_struts_changed()
+{
+	memset(cache_monitor, 0, sizeof(cache_monitor));
+	ewmh_desktop_list();
+}
+
+// find the dimensions, EXCLUDING STRUTS, of the monitor displaying point x,y.
+// struts of a panel on one desktop only count while that desktop's tag is showing,
+// matching the _NET_WORKAREA from ewmh_desktop_list()
 void monitor_dimensions_struts(int x, int y, workarea *mon)
 {
 	int i;
@@ -70,22 +96,25 @@ void monitor_dimensions_struts(int x, int y, workarea *mon)
 
 	monitor_dimensions(x, y, mon);
 
-	// strut cardinals are relative to the root window size, which is not necessarily the monitor size
-	XWindowAttributes *rattr = window_get_attributes(root);
 	int left = 0, right = 0, top = 0, bottom = 0;
+	bitmap tag = monitor_tag(mon);
 
 	Window win;
 	// walk the open apps and check for struts
 	// this is fairly lightweight thanks to some caches
 	winlist_ascend(windows_in_play(), i, win)
 	{
+		int idx = winlist_find(windows, win);
+		if (idx < 0 || !((wincache*)windows->data[idx])->has_struts) continue;
 		XWindowAttributes *attr = window_get_attributes(win);
 		if (attr && !attr->override_redirect
 			&& INTERSECT(attr->x, attr->y, attr->width, attr->height, mon->x, mon->y, mon->w, mon->h))
 		{
 			unsigned long strut[12]; memset(strut, 0, sizeof(strut));
-			if (window_get_cardinal_prop(win, netatoms[_NET_WM_STRUT_PARTIAL], strut, 12)
+			unsigned long d;
+			if ((window_get_cardinal_prop(win, netatoms[_NET_WM_STRUT_PARTIAL], strut, 12)
 				|| window_get_cardinal_prop(win, netatoms[_NET_WM_STRUT], strut, 4))
+				&& !(window_get_cardinal_prop(win, netatoms[_NET_WM_DESKTOP], &d, 1) && d < config_tags && !(TAG(d) & tag)))
 			{
 				// we only pay attention to the first four params
 				// this is no more complex that _NET_WM_STRUT, but newer stuff uses _PARTIAL
@@ -94,14 +123,7 @@ void monitor_dimensions_struts(int x, int y, workarea *mon)
 			}
 		}
 	}
-	// limit struts on any side to 1/3 monitor size
-	mon->l = MIN(mon->w/3, MAX(0, left-mon->x));
-	mon->r = MIN(mon->w/3, MAX(0, (mon->x+mon->w)-(rattr->width-right)));
-	mon->t = MIN(mon->h/3, MAX(0, top-mon->y));
-	mon->b = MIN(mon->h/3, MAX(0, (mon->y+mon->h)-(rattr->height-bottom)));
-	mon->x += mon->l; mon->y += mon->t;
-	mon->w -= (mon->l+mon->r);
-	mon->h -= (mon->t+mon->b);
+	monitor_apply_struts(mon, left, right, top, bottom);
 
 	// update cache. strust change rarely, so this is long-lived.
 	// see handle_propertynotify() also
@@ -134,3 +156,28 @@ void monitor_active(workarea *mon)
 	}
 	monitor_dimensions_struts(0, 0, mon);
 }
+
+// the current tag of a monitor. without -monitortags all monitors share current_tag
+bitmap monitor_tag(workarea *mon)
+{
+	if (!config_monitor_tags || mon->n >= MONITORS) return current_tag;
+	return monitor_tags[mon->n];
+}
+
+// xinerama screen number holding the center of a window. monitor_dimensions_struts()
+// is cached, so unlike client_extended_data() this costs no round trips
+int monitor_of_client(client *c)
+{
+	workarea mon;
+	monitor_dimensions_struts(c->x+c->w/2, c->y+c->h/2, &mon);
+	return mon.n;
+}
+
+// focus moved to another monitor, so current_tag becomes that monitor's tag
+void monitor_follow(client *c)
+{
+	if (!config_monitor_tags) return;
+	int n = monitor_of_client(c);
+	if (n < MONITORS && monitor_tags[n] != current_tag)
+		tag_set_current(monitor_tags[n]);
+}
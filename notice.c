@@ -0,0 +1,134 @@
+/* GoomwWM, Get out of my way, Window Manager!
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// expiry timer callback
+void notice_expire(void *data)
+{
+	winnotice *n = data;
+	box_hide(n->frame);
+	n->active = 0;
+}
+
+// display a text message near x,y for delay milliseconds.
+// a message with the same key as a visible one replaces it, otherwise new
+// messages stack upward over older ones
+void notice_show(unsigned long key, int delay, int x, int y, char *txt)
+{
+	int i; winnotice *n = NULL, *o;
+	workarea mon; monitor_dimensions_struts(x, y, &mon);
+
+	for (i = 0; i < NOTICES && !n; i++)
+		if (notices[i].active && notices[i].key == key) n = &notices[i];
+	for (i = 0; i < NOTICES && !n; i++)
+		if (!notices[i].active) n = &notices[i];
+	// all busy. recycle the oldest
+	if (!n) for (i = 0, n = &notices[0]; i < NOTICES; i++)
+		if (notices[i].stamp < n->stamp) n = &notices[i];
+
+	if (!n->frame)
+	{
+		n->frame = box_create(root, BOX_OVERRIDE, 0, 0, 1, 1, config_title_bg);
+		n->text = textbox_create(n->frame->window, TB_CENTER|TB_AUTOHEIGHT|TB_AUTOWIDTH,
+			8, 5, 1, 1, config_title_font, config_title_fg, config_title_bg, NULL, NULL);
+		XSelectInput(display, n->frame->window, ExposureMask);
+		window_set_ours(n->frame->window);
+		textbox_show(n->text);
+	}
+	timer_cancel(notice_expire, n);
+
+	textbox_text(n->text, txt);
+	textbox_moveresize(n->text, 8, 5, 1, 1);
+
+	int w = n->text->w + 16, h = n->text->h + 10;
+	int nx = MIN(mon.x+mon.w-n->text->w-26, MAX(mon.x+26, x - n->text->w/2));
+	int ny = MIN(mon.y+mon.h-n->text->h-20, MAX(mon.y+20, y - n->text->h/2));
+
+	// move above anything already showing in the same spot
+	for (i = 0; i < NOTICES; i++)
+	{
+		o = &notices[i];
+		if (o != n && o->active && INTERSECT(nx, ny, w, h, o->frame->x, o->frame->y, o->frame->w, o->frame->h))
+			{ ny = o->frame->y - h - 5; i = -1; }
+	}
+
+	box_moveresize(n->frame, nx, ny, w, h);
+	XMapRaised(display, n->frame->window);
+	// an already visible notice gets no Expose
+	if (n->active) textbox_draw(n->text);
+
+	n->key = key;
+	n->stamp = timestamp();
+	n->active = 1;
+	timer_add(delay, notice_expire, n);
+}
+
+// redraw a notice. returns true if the window was one of ours
+int notice_expose(Window w)
+{
+	int i; for (i = 0; i < NOTICES; i++)
+	{
+		if (notices[i].frame && notices[i].frame->window == w)
+		{
+			textbox_draw(notices[i].text);
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// drop all notice windows, so they're rebuilt with the current fonts and colors
+void notice_reset()
+{
+	int i; for (i = 0; i < NOTICES; i++)
+	{
+		winnotice *n = &notices[i];
+		timer_cancel(notice_expire, n);
+		if (n->frame)
+		{
+			textbox_free(n->text);
+			box_free(n->frame);
+		}
+		memset(n, 0, sizeof(winnotice));
+	}
+}
+
+// bottom right of screen
+void notice(const char *fmt, ...)
+{
+	char txt[100]; va_list ap;
+	va_start(ap,fmt); vsnprintf(txt, 100, fmt, ap); va_end(ap);
+	workarea mon; monitor_active(&mon);
+	notice_show(NOTICE_STATUS, SAYMS, mon.x+mon.w-1, mon.y+mon.h-1, txt);
+}
+
+// bottom left of screen
+void notification(int delay, const char *fmt, ...)
+{
+	char txt[100]; va_list ap;
+	va_start(ap,fmt); vsnprintf(txt, 100, fmt, ap); va_end(ap);
+	workarea mon; monitor_active(&mon);
+	notice_show(NOTICE_NOTIFY, delay, mon.x, mon.y+mon.h-1, txt);
+}
@@ -1,3 +1,8 @@
+void account(int category, long n);
+void account_measure();
+int account_growing(int category);
+void account_sample(void *data);
+int account_dump(FILE *f);
 box* box_create(Window parent, bitmap flags, short x, short y, short w, short h, char *color);
 void box_color(box *b, char *color);
 void box_moveresize(box *b, short x, short y, short w, short h);
@@ -5,20 +10,33 @@ void box_show(box *b);
 void box_hide(box *b);
 void box_draw(box *b);
 void box_free(box *b);
-void cli_message(Atom atom, char *cmd);
+Window cli_message(Atom atom, char *cmd);
+char* cli_reply(Window cli, Atom atom);
+int cli_connect();
+int cli_read(int fd, char *buf, size_t len);
+int cli_request(int fd, int cmd, char *arg);
+int cli_send(int fd, int cmd, char *arg);
+int cli_query(int fd, int cmd);
 int cli_main(int argc, char *argv[]);
+unsigned short client_state_bit(Atom state);
+int client_state_atoms(unsigned short state, Atom *atoms);
 void client_flush_state(client *c);
 int client_has_state(client *c, Atom state);
+int client_stage_state(client *c, Atom state);
 void client_add_state(client *c, Atom state);
 void client_remove_state(client *c, Atom state);
 void client_remove_all_states(client *c);
 void client_set_state(client *c, Atom state, int on);
 void client_descriptive_data(client *c);
+void client_forget_strings(wincache *cache, unsigned char which);
 void client_extended_data(client *c);
+int client_rule_string(winrule *r, char *str);
 int client_rule_match(client *c, winrule *r);
+void client_review_title(client *c);
+void client_decorate(client *c);
+void client_undecorate(wincache *cache);
 client* client_create(Window win);
 client* client_recreate(Window w);
-void client_free(client *c);
 int clients_intersect(client *a, client *b);
 int client_protocol_event(client *c, Atom protocol);
 void client_close(client *c);
@@ -26,16 +44,19 @@ int client_warp_check(client *c, int x, int y);
 void client_warp_pointer(client *c);
 void client_process_size_hints(client *c, int *x, int *y, int *w, int *h);
 void client_moveresize(client *c, unsigned int flags, int fx, int fy, int fw, int fh);
-void client_commit(client *c);
+void undo_begin();
+void undo_end();
+int client_commit(client *c);
 void client_rollback(client *c);
+void client_undo(client *c);
 void client_save_position(client *c);
 void client_save_position_horz(client *c);
 void client_save_position_vert(client *c);
 void client_restore_position(client *c, unsigned int smart, int x, int y, int w, int h);
 void client_restore_position_horz(client *c, unsigned int smart, int x, int w);
 void client_restore_position_vert(client *c, unsigned int smart, int y, int h);
-winlist* clients_fully_visible(workarea *zone, unsigned int tag, Window ignore);
-winlist* clients_partly_visible(workarea *zone, unsigned int tag, Window ignore);
+winlist* clients_fully_visible(workarea *zone, bitmap tag, Window ignore);
+winlist* clients_partly_visible(workarea *zone, bitmap tag, Window ignore);
 void client_expand(client *c, int directions, int x1, int y1, int w1, int h1, int mx, int my, int mw, int mh);
 void client_contract(client *c, int directions);
 void client_snapto(client *c, int direction);
@@ -55,7 +76,7 @@ void client_deactivate(client *c, client *a);
 void client_activate(client *c, int raise, int warp);
 void client_set_wm_state(client *c, unsigned long state);
 unsigned long client_get_wm_state(client *c);
-client* client_active(unsigned int tag);
+client* client_active(bitmap tag);
 void client_toggle_vlock(client *c);
 void client_toggle_hlock(client *c);
 void client_nws_fullscreen(client *c, int action);
@@ -82,29 +103,36 @@ void client_minimize(client *c);
 void client_restore(client *c);
 void client_shade(client *c);
 void client_reveal(client *c);
-void client_switcher(unsigned int tag);
-void client_toggle_tag(client *c, unsigned int tag, int flash);
+void client_switcher_done(int line, char *text, void *data);
+void client_switcher(bitmap tag);
+void client_toggle_tag(client *c, bitmap tag, int flash);
 client* client_find(char *pattern);
 void client_start(char *pattern);
-void client_find_or_start(char *pattern);
+int client_find_or_start(char *pattern);
 void client_rules_ewmh(client *c);
-void client_rules_monitor(client *c);
-void client_rules_moveresize(client *c);
+void client_rules_geometry(client *c);
 void client_rules_locks(client *c);
 void client_rules_tags(client *c);
-void client_rules_moveresize_post(client *c);
+void client_rules_ops(client *c, winrule *rule, int first, int last);
 void client_rules_apply(client *c, bool reset);
 void event_client_dump(client *c);
 void ewmh_client_list();
 void ewmh_active_window(Window w);
 void ewmh_desktop_list();
+void flash_hide(void *data);
+void flash_show(Window w, int x, int y, int width, int height, char *color, int delay);
 int main(int argc, char *argv[]);
-void grab_keycode(unsigned int mask, KeyCode keycode);
-void grab_key(unsigned int mask, KeySym key);
+void grab_keycode(unsigned int mask, KeyCode keycode, int grab);
+void grab_key(unsigned int mask, KeySym key, int grab);
+int grab_combos(KeySym *syms, unsigned int *masks);
+void grab_keys_update(KeySym *old_syms, unsigned int *old_masks, int old_n);
 void grab_keys_and_buttons();
+void prefix_cancel();
+void drag_cancel();
 void handle_keypress(XEvent *ev);
 void handle_buttonpress(XEvent *ev);
 void handle_buttonrelease(XEvent *ev);
+void handle_focus(XEvent *ev);
 void handle_motionnotify(XEvent *ev);
 void handle_createnotify(XEvent *ev);
 void handle_destroynotify(XEvent *ev);
@@ -118,27 +146,86 @@ void handle_propertynotify(XEvent *ev);
 void handle_enternotify(XEvent *ev);
 void handle_mappingnotify(XEvent *ev);
 void handle_expose(XEvent *ev);
-void menu_draw(textbox *text, textbox **boxes, int max_lines, int selected, char **filtered);
-int menu(char **lines, char **input, char *prompt, int selected);
-char* prompt(char *ps);
+char* ipc_path();
+int ipc_command(char *name);
+int ipc_command_atom(Atom atom);
+int ipc_send(int fd, char *buf, size_t len);
+int ipc_reply(int fd, int status, char *out, size_t outlen, char *err, size_t errlen);
+void ipc_ack();
+int ipc_execute(int cmd, char *msg, FILE *out, FILE *err);
+int ipc_run(int cmd, char *msg, char **out, size_t *outlen, char **err, size_t *errlen);
+void ipc_close(winipc *p);
+int ipc_request(winipc *p, char *name, char *arg);
+void ipc_read(int fd, void *data);
+void ipc_accept(int fd, void *data);
+void ipc_cleanup();
+void ipc_setup();
+char** launch_argv(char *cmd);
+char** launch_environ(char *id);
+void launch_mapped(Window w);
+void launch_dump(FILE *f);
+void loop_catch(int sig);
+void loop_unblock();
+void loop_dump(FILE *f);
+void loop_handle_signal(int sig);
+void loop_watch(int fd, int add);
+int loop_add(int fd, loop_callback callback, void *data);
+void loop_remove(int fd);
+void loop_ready(int fd);
+void loop_setup(char **argv);
+int loop_wait();
+void menu_draw(struct localmenu *m);
+void menu_close(int chosen);
+void menu_cancel();
+void menu(char **lines, char *prompt, int selected, menu_callback callback, void *data);
+void prompt(char *ps, menu_callback callback, void *data);
+void prompt_exec(int line, char *text, void *data);
+int menu_event(XEvent *ev);
 void monitor_dimensions(int x, int y, workarea *mon);
+void monitor_apply_struts(workarea *mon, int left, int right, int top, int bottom);
+void monitor_struts_changed();
 void monitor_dimensions_struts(int x, int y, workarea *mon);
 void monitor_active(workarea *mon);
+bitmap monitor_tag(workarea *mon);
+int monitor_of_client(client *c);
+void monitor_follow(client *c);
+void notice_expire(void *data);
+void notice_show(unsigned long key, int delay, int x, int y, char *txt);
+int notice_expose(Window w);
+void notice_reset();
+void notice(const char *fmt, ...);
+void notification(int delay, const char *fmt, ...);
+char* rule_prefilter(char *pat);
+void rule_compile(winrule *rule);
 int rule_parse(char *rulestr);
+void rule_release(winrule *rule);
 void rule_free(winrule *rule);
+void ruleset_switcher_done(int line, char *text, void *data);
 void ruleset_switcher();
+void rule_dump(FILE *f);
+void rule_dump_exit();
+void ruleset_free_all();
+void ruleset_compile(winruleset *set);
 void rulelist_apply(winrule *list);
 void rule_apply(winrule *rule);
-void rule_execute(char *rulestr);
-void ruleset_execute(char *name);
-unsigned int tag_to_desktop(unsigned int tag);
-unsigned int desktop_to_tag(unsigned int desktop);
-void tag_set_current(unsigned int tag);
-void tag_raise(unsigned int tag);
+int rule_execute(char *rulestr);
+int ruleset_execute(char *name);
+void snapshot_put(unsigned long **buf, int *len, int *size, unsigned long v);
+void snapshot_put_undo(unsigned long **buf, int *len, int *size, winundo *undo);
+void snapshot_save();
+int snapshot_get_undo(unsigned long *buf, int pos, int len, winundo *undo);
+winlist* snapshot_load(winlist *children);
+unsigned int tag_to_desktop(bitmap tag);
+bitmap desktop_to_tag(unsigned int desktop);
+void tag_members_update(Window w, bitmap old, bitmap tags);
+winlist* tag_windows(bitmap tags);
+void tag_set_current(bitmap tag);
+void tag_raise(bitmap tag);
 void tag_auto_switch();
-void tag_only(unsigned int tag);
-void tag_close(unsigned int tag);
+void tag_only(bitmap tag);
+void tag_close(bitmap tag);
 textbox* textbox_create(Window parent, bitmap flags, short x, short y, short w, short h, char *font, char *fg, char *bg, char *text, char *prompt);
+void textbox_font_free(textbox *tb);
 void textbox_font(textbox *tb, char *font, char *fg, char *bg);
 void textbox_extents(textbox *tb);
 void textbox_text(textbox *tb, char *text);
@@ -159,9 +246,20 @@ void textbox_cursor_ins(textbox *tb, char c);
 void textbox_cursor_del(textbox *tb);
 void textbox_cursor_bkspc(textbox *tb);
 int textbox_keypress(textbox *tb, XEvent *ev);
+unsigned long long timer_now();
+int timer_add(int ms, timer_callback callback, void *data);
+void timer_cancel(timer_callback callback, void *data);
+int timer_next();
+void timer_run();
 void* allocate(unsigned long bytes);
 void* allocate_clear(unsigned long bytes);
 void* reallocate(void *ptr, unsigned long bytes);
+void* arena_alloc(arena *a, unsigned long bytes);
+void* arena_alloc_clear(arena *a, unsigned long bytes);
+void arena_reset(arena *a);
+unsigned long arena_used(arena *a);
+char* intern(char *str);
+void intern_release(char *str);
 char* strtrim(char *str);
 void catch_exit(int sig);
 int execsh(char *cmd);
@@ -174,27 +272,35 @@ unsigned int color_get(const char *name);
 int pointer_get(int *x, int *y);
 int keycode_is_mod(unsigned int code);
 int modkey_is_down();
-int take_keyboard(Window w);
-int take_pointer(Window w, unsigned long mask, Cursor cur);
+int take_attempt(wingrab *g);
+void take_retry(void *data);
+int take_grab(wingrab *g, Window w, unsigned long mask, Cursor cur, grab_callback failed);
+int take_keyboard(Window w, grab_callback failed);
+int take_pointer(Window w, unsigned long mask, Cursor cur, grab_callback failed);
 void release_keyboard();
 void release_pointer();
-void message_box(int delay, int x, int y, char *fgc, char *bgc, char *bc, char *txt);
-void notice(const char *fmt, ...);
-void notification(int delay, const char *fmt, ...);
 void event_log(const char *e, Window w);
 void event_note(const char *fmt, ...);
 void window_select(Window w);
+void window_set_ours(Window w);
 XWindowAttributes* window_get_attributes(Window w);
+void window_prefetch();
+void window_prefetch_free();
+void window_prefetch_forget(Window w);
+int window_get_prefetched(Window w, Atom prop, Atom *type, int *items, void *buffer, int bytes);
+Window window_focus();
 int window_get_prop(Window w, Atom prop, Atom *type, int *items, void *buffer, int bytes);
 char* window_get_text_prop(Window w, Atom atom);
 int window_set_text_prop(Window w, Atom atom, char *txt);
 int window_get_atom_prop(Window w, Atom atom, Atom *list, int count);
 void window_set_atom_prop(Window w, Atom prop, Atom *atoms, int count);
 int window_get_cardinal_prop(Window w, Atom atom, unsigned long *list, int count);
+void window_check_struts(Window w, wincache *cache);
 void window_set_cardinal_prop(Window w, Atom prop, unsigned long *values, int count);
 void window_unset_prop(Window w, Atom prop);
 int window_send_message(Window target, Window subject, Atom atom, unsigned long protocol, unsigned long mask);
 winlist* windows_in_play();
+void windows_in_play_add(winlist *mapped);
 winlist* window_children();
 int window_is_active(Window w);
 winlist* winlist_new();
@@ -205,14 +311,21 @@ void winlist_free(winlist *l);
 int winlist_find(winlist *l, Window w);
 int winlist_forget(winlist *l, Window w);
 void winlist_reverse(winlist *l);
+void winring_resize(winring *r, int size);
+void winring_free(winring *r);
 int oops(Display *d, XErrorEvent *ee);
 void reset_lazy_caches();
 void reset_cache_xattr();
 void reset_cache_client();
 void reset_cache_inplay();
+void reset_cache_tagged();
 void setup_screen();
 unsigned int parse_key_mask(char *keystr, unsigned int def);
 void setup_keyboard_options(int ac, char *av[]);
 void setup_general_options(int ac, char *av[]);
 void setup_rule_options(int ac, char *av[]);
+char** config_args(int argc, char *argv[], int *count);
+void config_args_free(int argc, char *argv[], int ac, char *av[]);
+int config_rules_differ(int ac1, char *av1[], int ac2, char *av2[]);
+void wm_reload();
 int wm_main(int argc, char *argv[]);
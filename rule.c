@@ -24,8 +24,65 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 */
 
-// load a rule specified on cmd line or .goomwwmrc
-int rule_parse(char *rulestr)
+// find the longest literal run that any match of an extended regex must contain.
+// gives up on anything complicated
+char* rule_prefilter(char *pat)
+{
+	int i, start = -1, best = 0, len = 0;
+	if (strpbrk(pat, "|\\([")) return NULL;
+	for (i = 0; ; i++)
+	{
+		char ch = pat[i];
+		// a character followed by * ? or {n,m} is optional
+		int optional = ch && pat[i+1] && strchr("*?{", pat[i+1]);
+		if (!ch || optional || strchr(".*+?{}^$]", ch))
+		{
+			if (start >= 0 && i-start > len) { best = start; len = i-start; }
+			start = -1;
+			if (ch == '{') while (pat[i+1] && pat[i] != '}') i++;
+			if (!ch) break;
+			continue;
+		}
+		if (start < 0) start = i;
+	}
+	return len > 1 ? strndup(pat+best, len): NULL;
+}
+
+// rule flags that trigger each compiled op
+bitmap ruleops[RULEOPS] = {
+	[RULEOP_STATES]    = RULE_ABOVE|RULE_BELOW|RULE_STICKY|RULE_SKIPTBAR|RULE_SKIPPAGE|RULE_FULLSCREEN|RULE_MAXHORZ|RULE_MAXVERT,
+	[RULEOP_GEOMETRY]  = RULE_MONITOR1|RULE_MONITOR2|RULE_MONITOR3|RULE_SMALL|RULE_MEDIUM|RULE_LARGE|RULE_COVER|RULE_SIZE
+		|RULE_TOP|RULE_LEFT|RULE_RIGHT|RULE_BOTTOM|RULE_CENTER|RULE_POINTER,
+	[RULEOP_LOCKS]     = RULE_HLOCK|RULE_VLOCK,
+	[RULEOP_TAGS]      = RULE_TAGS,
+	[RULEOP_SNAPRIGHT] = RULE_SNAPRIGHT,
+	[RULEOP_SNAPLEFT]  = RULE_SNAPLEFT,
+	[RULEOP_SNAPDOWN]  = RULE_SNAPDOWN,
+	[RULEOP_SNAPUP]    = RULE_SNAPUP,
+	[RULEOP_CONTRACT]  = RULE_CONTRACT,
+	[RULEOP_EXPAND]    = RULE_EXPAND,
+	[RULEOP_REPLACE]   = RULE_REPLACE,
+	[RULEOP_DUPLICATE] = RULE_DUPLICATE,
+	[RULEOP_HUNTILE]   = RULE_HUNTILE,
+	[RULEOP_HTILE]     = RULE_HTILE,
+	[RULEOP_VUNTILE]   = RULE_VUNTILE,
+	[RULEOP_VTILE]     = RULE_VTILE,
+	[RULEOP_LOWER]     = RULE_LOWER,
+	[RULEOP_RAISE]     = RULE_RAISE,
+	[RULEOP_RESTORE]   = RULE_RESTORE,
+	[RULEOP_MINIMIZE]  = RULE_MINIMIZE,
+};
+
+// compile a rule's flags into the list of actions client_rules_apply() needs
+void rule_compile(winrule *rule)
+{
+	int i; rule->nops = 0;
+	for (i = 0; i < RULEOPS; i++)
+		if (rule->flags & ruleops[i]) rule->ops[rule->nops++] = i;
+}
+
+// build a rule without adding it to config_rules. NULL if the pattern won't compile
+winrule* rule_create(char *rulestr)
 {
 	winrule *new = allocate_clear(sizeof(winrule));
 	char *str = strdup(rulestr); strtrim(str);
@@ -56,6 +113,12 @@ int rule_parse(char *rulestr)
 				new->h = strtol(p, &p, 10);
 				new->h_is_pct = (*p == '%') ? 1:0;
 			} else
+			// tag1 .. tag64
+			if (regquick("^tag[0-9]+$", flag))
+			{
+				int n = atoi(flag+3);
+				if (n >= 1 && n <= TAGS) { new->tags |= TAG(n-1); new->flags |= RULE_TAGS; }
+			} else
 			// check known flags
 			{
 				int i; for (i = 0; i < sizeof(rulemap)/sizeof(winrulemap); i++)
@@ -70,11 +133,16 @@ int rule_parse(char *rulestr)
 	char *pat = new->pattern;
 	if (regquick("^(class|name|title):", pat)) pat = strchr(pat, ':')+1;
 
+	if (strchr(new->pattern, ':') && strchr("cnte", new->pattern[0]))
+		new->field = new->pattern[0];
+
 	int ok = 0;
 	if (regcomp(&new->re, pat, REG_EXTENDED|REG_ICASE|REG_NOSUB) == 0)
 	{
-		new->next = config_rules;
-		config_rules = new;
+		// most patterns are plain strings. avoid regexec for them
+		if (!strpbrk(pat, ".[]()*+?{}|^$\\")) new->literal = strdup(pat);
+		else new->prefilter = rule_prefilter(pat);
+		rule_compile(new);
 		ok = 1;
 	} else
 	{
@@ -82,18 +150,44 @@ int rule_parse(char *rulestr)
 		free(new->pattern); free(new);
 	}
 	free(str);
-	return ok;
+	return ok ? new: NULL;
 }
 
-// release rule memory
-void rule_free(winrule *rule)
+// load a rule specified on cmd line or .goomwwmrc
+int rule_parse(char *rulestr)
+{
+	winrule *new = rule_create(rulestr);
+	if (!new) return 0;
+	rule_generation++;
+	new->next = config_rules;
+	config_rules = new;
+	return 1;
+}
+
+// release memory of a rule from rule_create() that was never in config_rules
+void rule_release(winrule *rule)
 {
 	if (!rule) return;
 	regfree(&rule->re);
 	free(rule->pattern);
+	free(rule->literal);
+	free(rule->prefilter);
 	free(rule);
 }
 
+// release rule memory. memoised matches may point at it
+void rule_free(winrule *rule)
+{
+	rule_release(rule);
+	rule_generation++;
+}
+
+// ruleset switcher selection
+void ruleset_switcher_done(int line, char *text, void *data)
+{
+	if (line >= 0) ruleset_execute(text);
+}
+
 // pick a ruleset to execute
 void ruleset_switcher()
 {
@@ -103,58 +197,113 @@ void ruleset_switcher()
 	for (count = 0, set = config_rulesets; set; count++, set = set->next);
 	list = allocate_clear(sizeof(char*) * (count+1)); // +1 NULL sell terminates
 	// build a simple list of rule file names
-	for (i = count-1, set = config_rulesets; set; i--, set = set->next) list[i] = basename(set->name);
+	for (i = count-1, set = config_rulesets; set; i--, set = set->next) list[i] = strdup(basename(set->name));
 
-	if (!fork())
+	menu(list, "> ", 0, ruleset_switcher_done, NULL);
+}
+
+// per-rule profile: match attempts, hits, time spent in regexec, and X requests made
+// when applied. rules are listed in definition order, one ruleset at a time
+void rule_dump(FILE *f)
+{
+	int i; winruleset *set; winrule *rule;
+	for (set = config_rulesets; set; set = set->next)
 	{
-		display = XOpenDisplay(0);
-		XSync(display, True);
-		int n = menu(list, NULL, "> ", 0);
-		if (n >= 0 && list[n])
+		fprintf(f, "%s:\n", set->name);
+		for (i = 0; i < set->count; i++)
 		{
-			cli_message(gatoms[GOOMWWM_RULESET], list[n]);
-			usleep(300000);
+			rule = set->list[i];
+			fprintf(f, "  %-30s attempts %lu hits %lu applied %lu xops %lu regex %.3fms\n", rule->pattern,
+				rule->attempts, rule->hits, rule->applied, rule->xops, rule->regex_time * 1000);
 		}
-		exit(EXIT_SUCCESS);
 	}
-	free(list);
 }
 
-// apply a rule list to all windows in current_tag
+// -rulestats
+void rule_dump_exit()
+{
+	if (config_rule_stats) rule_dump(stderr);
+}
+
+// release every ruleset and its rules. config reload rebuilds them
+void ruleset_free_all()
+{
+	winrule *rule, *next;
+	winruleset *set = config_rulesets;
+	while (set)
+	{
+		winruleset *n = set->next;
+		for (rule = set->rules; rule; rule = next)
+		{
+			next = rule->next;
+			rule_free(rule);
+		}
+		free(set->list);
+		free(set->name);
+		free(set);
+		set = n;
+	}
+	config_rulesets = NULL;
+	config_rules = NULL;
+}
+
+// build a ruleset's definition-order array from its reverse-order list
+void ruleset_compile(winruleset *set)
+{
+	int i; winrule *rule;
+	for (set->count = 0, rule = set->rules; rule; set->count++, rule = rule->next);
+	free(set->list); set->list = allocate_clear(sizeof(winrule*) * (set->count+1));
+	for (i = set->count-1, rule = set->rules; rule; i--, rule = rule->next)
+		set->list[i] = rule;
+}
+
+// apply a rule list to all windows in current_tag.
+// every window is ruled against one snapshot: the caches are reset once up front, and
+// client_moveresize() keeps cached clients current, so there's no per-window XSync
 void rulelist_apply(winrule *list)
 {
-	int i, done = 0; Window w; client *c;
+	int i; Window w; client *c;
 	winrule *bak = config_rules; config_rules = list;
+	reset_cache_xattr();
+	reset_cache_client();
+
+	// collect targets first, so restacking can't reorder the walk
+	winlist *targets = winlist_new();
 	tag_descend(i, w, c, current_tag)
-		if (!done)
-	{
-		reset_cache_xattr();
-		reset_cache_client();
-		c = client_create(w);
-		if (c) client_rules_apply(c, RULESDEF);
-		if (c && c->is_ruled && c->rule && c->rule->flags & RULE_ONCE) done = 1;
-		XSync(display, False);
-	}
+		winlist_append(targets, w, NULL);
 	clients_descend(windows_shaded, i, w, c)
-		if (!done && c->manage && c->cache->tags & current_tag)
-	{
-		reset_cache_xattr();
-		reset_cache_client();
-		c = client_create(w);
-		if (c) client_rules_apply(c, RULESDEF);
-		if (c && c->is_ruled && c->rule && c->rule->flags & RULE_ONCE) done = 1;
-		XSync(display, False);
-	}
+		if (c->manage && c->cache->tags & current_tag && winlist_find(targets, w) < 0)
+			winlist_append(targets, w, NULL);
 	clients_descend(windows_minimized, i, w, c)
-		if (!done && c->manage && c->cache->tags & current_tag)
+		if (c->manage && c->cache->tags & current_tag && winlist_find(targets, w) < 0)
+			winlist_append(targets, w, NULL);
+
+	// one undo step for the whole run. a window gets a cell only if the rules changed it,
+	// holding where it was before this step began
+	undo_begin();
+	clients_ascend(targets, i, w, c)
 	{
-		reset_cache_xattr();
-		reset_cache_client();
-		c = client_create(w);
-		if (c) client_rules_apply(c, RULESDEF);
-		if (c && c->is_ruled && c->rule && c->rule->flags & RULE_ONCE) done = 1;
-		XSync(display, False);
+		client_extended_data(c);
+		winundo *undo = winring_top(&c->cache->undo), was;
+		int had = undo && undo->txn == undo_txn;
+		was.x = c->x; was.y = c->y; was.w = c->w; was.h = c->h;
+		was.state = c->state; was.txn = undo_txn;
+		client_rules_apply(c, RULESDEF);
+		// an earlier rule in this step already saved the starting point
+		if (c->manage && !had && (was.x != c->x || was.y != c->y || was.w != c->w || was.h != c->h || was.state != c->state))
+		{
+			// ops like snap commit mid-rule, after geometry rules already moved the window
+			undo = winring_top(&c->cache->undo);
+			if (!undo || undo->txn != undo_txn) undo = winring_push(&c->cache->undo, config_undo);
+			*undo = was;
+		}
+		if (c->is_ruled && c->rule && c->rule->flags & RULE_ONCE) break;
 	}
+	undo_end();
+	winlist_free(targets);
+
+	// clients were ruled against list, not config_rules
+	reset_cache_client();
 	config_rules = bak;
 }
 
@@ -167,37 +316,33 @@ void rule_apply(winrule *rule)
 	rule->next = next;
 }
 
-// execute a rule on open windows
-void rule_execute(char *rulestr)
+// execute a rule on open windows. false if it didn't parse
+int rule_execute(char *rulestr)
 {
-	if (rule_parse(rulestr))
-	{
-		winrule *rule = config_rules;
-		config_rules = rule->next;
-		rule_apply(rule);
-		rule_free(rule);
-	}
+	if (!rule_parse(rulestr)) return 0;
+	winrule *rule = config_rules;
+	config_rules = rule->next;
+	rule_apply(rule);
+	rule_free(rule);
+	XFlush(display);
+	return 1;
 }
 
-// execute a ruleset on open windows
-void ruleset_execute(char *name)
+// execute a ruleset on open windows. false if there is no such ruleset
+int ruleset_execute(char *name)
 {
-	winruleset *set = NULL;
+	int i; winruleset *set = NULL;
 	// find ruleset by index
 	for (set = config_rulesets; set && strcasecmp(name, set->name); set = set->next);
-	if (set && set->rules)
+	if (set && set->count)
 	{
-		// bit odd. rules lists are lifos present, but it's more intuitive to process
-		// rulesets in the order they were defined. should clean this up, but for now,
-		// labouriously walk the list backwards
-		winrule *rule = set->rules;
-		while (rule->next) rule = rule->next;
-		while (rule)
-		{
-			rule_apply(rule);
-			winrule *prev = set->rules;
-			while (prev && prev->next != rule) prev = prev->next;
-			rule = prev;
-		}
+		// the whole ruleset is one undo step
+		undo_begin();
+		for (i = 0; i < set->count; i++)
+			rule_apply(set->list[i]);
+		undo_end();
+		// everything goes out in one go
+		XFlush(display);
 	}
-}
\ No newline at end of file
+	return set ? 1: 0;
+}
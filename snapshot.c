@@ -0,0 +1,210 @@
+/* GoomwWM, Get out of my way, Window Manager!
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// carry per-window state across an exec-restart in a root window property, so
+// tags, locks, undo chains and focus order survive and rules aren't re-run.
+// everything is a flat list of CARDINALs:
+//   header: SNAPSHOT_VERSION, records, activated, minimized, shaded
+//   record: window, flags, tags (low, high 32 bits), last_corner, activated/minimized/shaded position
+//           (or -1), undo count, ewmh count, then each winundo
+//   winundo: x, y, w, h, undo step (txn), states, state...
+
+#define SNAPSHOT_VERSION 3
+#define SNAPSHOT_HLOCK   (1<<0)
+#define SNAPSHOT_VLOCK   (1<<1)
+#define SNAPSHOT_MAPPED  (1<<2)
+
+// append a value, growing the buffer as needed
+void snapshot_put(unsigned long **buf, int *len, int *size, unsigned long v)
+{
+	if (*len == *size)
+	{
+		*size = *size ? *size * 2: 256;
+		*buf = reallocate(*buf, sizeof(unsigned long) * *size);
+	}
+	(*buf)[(*len)++] = v;
+}
+
+// append an undo cell
+void snapshot_put_undo(unsigned long **buf, int *len, int *size, winundo *undo)
+{
+	int i; Atom state[CLIENTSTATE];
+	int states = client_state_atoms(undo->state, state);
+	snapshot_put(buf, len, size, undo->x);
+	snapshot_put(buf, len, size, undo->y);
+	snapshot_put(buf, len, size, undo->w);
+	snapshot_put(buf, len, size, undo->h);
+	snapshot_put(buf, len, size, undo->txn);
+	snapshot_put(buf, len, size, states);
+	for (i = 0; i < states; i++)
+		snapshot_put(buf, len, size, state[i]);
+}
+
+// write the snapshot to the root window. call right before exec
+void snapshot_save()
+{
+	int i, r, len = 0, size = 0, records = 0; Window w;
+	unsigned long *buf = NULL;
+
+	snapshot_put(&buf, &len, &size, SNAPSHOT_VERSION);
+	snapshot_put(&buf, &len, &size, 0);
+	snapshot_put(&buf, &len, &size, windows_activated->len);
+	snapshot_put(&buf, &len, &size, windows_minimized->len);
+	snapshot_put(&buf, &len, &size, windows_shaded->len);
+
+	winlist_ascend(windows, i, w)
+	{
+		wincache *cache = windows->data[i];
+		if (!cache || cache->is_ours) continue;
+		int activated = winlist_find(windows_activated, w);
+		int minimized = winlist_find(windows_minimized, w);
+		int shaded    = winlist_find(windows_shaded, w);
+		if (!cache->tags && !cache->undo.len && !cache->ewmh && !cache->has_mapped
+			&& activated < 0 && minimized < 0 && shaded < 0) continue;
+
+		snapshot_put(&buf, &len, &size, w);
+		snapshot_put(&buf, &len, &size, (cache->hlock ? SNAPSHOT_HLOCK: 0)
+			| (cache->vlock ? SNAPSHOT_VLOCK: 0) | (cache->has_mapped ? SNAPSHOT_MAPPED: 0));
+		snapshot_put(&buf, &len, &size, cache->tags & 0xffffffff);
+		snapshot_put(&buf, &len, &size, cache->tags >> 32);
+		snapshot_put(&buf, &len, &size, cache->last_corner);
+		snapshot_put(&buf, &len, &size, activated);
+		snapshot_put(&buf, &len, &size, minimized);
+		snapshot_put(&buf, &len, &size, shaded);
+		snapshot_put(&buf, &len, &size, cache->undo.len);
+		snapshot_put(&buf, &len, &size, cache->ewmh ? 1: 0);
+		// newest first
+		for (r = 0; r < cache->undo.len; r++)
+			snapshot_put_undo(&buf, &len, &size, winring_at(&cache->undo, r));
+		if (cache->ewmh) snapshot_put_undo(&buf, &len, &size, cache->ewmh);
+		records++;
+	}
+	buf[1] = records;
+
+	XChangeProperty(display, root, gatoms[GOOMWWM_SNAPSHOT], XA_CARDINAL, 32, PropModeReplace, (unsigned char*)buf, len);
+	// must reach the server before exec closes our connection
+	XSync(display, False);
+	free(buf);
+}
+
+// read an undo cell. returns the new read position, or -1 if truncated
+int snapshot_get_undo(unsigned long *buf, int pos, int len, winundo *undo)
+{
+	int i;
+	if (pos+6 > len || buf[pos+5] > CLIENTSTATE || pos+6+(int)buf[pos+5] > len) return -1;
+	memset(undo, 0, sizeof(winundo));
+	undo->x = buf[pos]; undo->y = buf[pos+1]; undo->w = buf[pos+2]; undo->h = buf[pos+3];
+	undo->txn = buf[pos+4];
+	// later steps must not reuse an id still in a ring, or unrelated windows would roll back together
+	undo_txns = MAX(undo_txns, undo->txn);
+	int states = buf[pos+5]; pos += 6;
+	for (i = 0; i < states; i++) undo->state |= client_state_bit(buf[pos++]);
+	return pos;
+}
+
+// read and remove the snapshot left by a previous instance. windows in children
+// that have a record get a restored wincache in windows, and the activated,
+// minimized and shaded lists are rebuilt in their old order. returns the
+// restored windows, which setup_screen() need not rule or list again
+winlist* snapshot_load(winlist *children)
+{
+	winlist *restored = winlist_new();
+	Atom type; int format; unsigned long len, remain;
+	unsigned char *ret = NULL;
+
+	if (XGetWindowProperty(display, root, gatoms[GOOMWWM_SNAPSHOT], 0, LONG_MAX/4, True, XA_CARDINAL,
+		&type, &format, &len, &remain, &ret) != Success || !ret || type != XA_CARDINAL || format != 32
+		|| len < 5 || ((unsigned long*)ret)[0] != SNAPSHOT_VERSION)
+	{
+		if (ret) XFree(ret);
+		return restored;
+	}
+	unsigned long *buf = (unsigned long*)ret;
+	int i, r, pos = 5, records = buf[1], lens[3] = { buf[2], buf[3], buf[4] };
+	winlist *lists[3] = { windows_activated, windows_minimized, windows_shaded };
+	Window *order[3];
+	// any client can write the property. a list can't be longer than the records
+	for (i = 0; i < 3; i++)
+	{
+		lens[i] = MAX(0, MIN(lens[i], (int)len));
+		order[i] = allocate_clear(sizeof(Window) * (lens[i]+1));
+	}
+
+	for (r = 0; r < records && pos+10 <= (int)len; r++)
+	{
+		Window w = buf[pos];
+		wincache *cache = allocate_clear(sizeof(wincache));
+		cache->hlock = buf[pos+1] & SNAPSHOT_HLOCK ? 1:0;
+		cache->vlock = buf[pos+1] & SNAPSHOT_VLOCK ? 1:0;
+		cache->has_mapped = buf[pos+1] & SNAPSHOT_MAPPED ? 1:0;
+		cache->tags = (bitmap)(buf[pos+2] & 0xffffffff) | (bitmap)(buf[pos+3] & 0xffffffff) << 32;
+		// -tags may have shrunk across the restart
+		cache->tags &= TAGMASK;
+		cache->last_corner = buf[pos+4];
+		for (i = 0; i < 3; i++)
+			if ((long)buf[pos+5+i] >= 0 && (long)buf[pos+5+i] < lens[i])
+				order[i][buf[pos+5+i]] = w;
+		int undos = buf[pos+8], ewmhs = buf[pos+9];
+		pos += 10;
+		// bounded by the ring size and by what's left of the property, each cell taking 6+
+		undos = MAX(0, MIN(undos, MIN(UNDOMAX, ((int)len-pos)/6)));
+		// cells are newest first, so push them oldest first. -undodepth may have shrunk
+		winundo *cells = allocate(sizeof(winundo) * (MAX(0, undos)+1));
+		for (i = 0; i < undos && pos >= 0; i++) pos = snapshot_get_undo(buf, pos, len, &cells[i]);
+		if (pos >= 0)
+			for (i = MIN(undos, config_undo)-1; i >= 0; i--)
+				*winring_push(&cache->undo, config_undo) = cells[i];
+		free(cells);
+		for (i = 0; i < ewmhs && pos >= 0; i++)
+		{
+			if (!cache->ewmh) cache->ewmh = allocate_clear(sizeof(winundo));
+			pos = snapshot_get_undo(buf, pos, len, cache->ewmh);
+		}
+
+		// windows that went away during the restart are just skipped
+		if (winlist_find(children, w) >= 0 && winlist_find(windows, w) < 0)
+		{
+			winlist_append(windows, w, cache);
+			winlist_append(restored, w, NULL);
+			tag_members_update(w, 0, cache->tags);
+		}
+		else
+		{
+			winring_free(&cache->undo);
+			free(cache->ewmh); free(cache);
+		}
+		if (pos < 0) break;
+	}
+	for (i = 0; i < 3; i++)
+	{
+		for (r = 0; r < lens[i]; r++)
+			if (order[i][r] && winlist_find(restored, order[i][r]) >= 0)
+				winlist_append(lists[i], order[i][r], NULL);
+		free(order[i]);
+	}
+	XFree(ret);
+	return restored;
+}
@@ -26,64 +26,143 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 // for the benefit of EWMH type pagers, tag = desktop
 // but, since a window can have multiple tags... oh well
-unsigned int tag_to_desktop(unsigned int tag)
+unsigned int tag_to_desktop(bitmap tag)
 {
-	unsigned int i; for (i = 0; i < TAGS; i++) if (tag & (1<<i)) return i;
-	return 0xffffffff;
+	tag &= TAGMASK;
+	return tag ? __builtin_ctzll(tag): 0xffffffff;
 }
 
-unsigned int desktop_to_tag(unsigned int desktop)
+bitmap desktop_to_tag(unsigned int desktop)
 {
-	return (desktop == 0xffffffff) ? 0: 1<<desktop;
+	return desktop < config_tags ? TAG(desktop): 0;
+}
+
+// keep tag_members in step when a window's tags change from old to tags
+void tag_members_update(Window w, bitmap old, bitmap tags)
+{
+	int i; bitmap m;
+	tag_bits(i, old ^ tags, m)
+	{
+		if (tags & TAG(i)) winlist_append(tag_members[i], w, NULL);
+		else winlist_forget(tag_members[i], w);
+	}
+	if (old != tags) reset_cache_tagged();
+}
+
+// windows_in_play() narrowed to members of any of tags, in the same stacking order.
+// tags == 0 means everything. lists are cached until reset_cache_inplay()
+winlist* tag_windows(bitmap tags)
+{
+	int i, j, n, idx; Window w; bitmap m;
+	if (!tags) return windows_in_play();
+
+	idx = winlist_find(cache_tagged, tags);
+	if (idx >= 0) return cache_tagged->data[idx];
+
+	// reuse a slot emptied by reset_cache_inplay()
+	idx = winlist_find(cache_tagged, 0);
+	if (idx < 0) idx = winlist_append(cache_tagged, 0, winlist_new());
+	cache_tagged->array[idx] = tags;
+	winlist *l = cache_tagged->data[idx], *inplay = windows_in_play();
+
+	// collect members with their stacking positions, then insertion sort. tags are small
+	int *pos = allocate(sizeof(int) * (inplay->len+1));
+	n = 0;
+	tag_bits(i, tags, m)
+	{
+		winlist_ascend(tag_members[i], j, w)
+		{
+			int p = winlist_find(inplay, w), k;
+			if (p < 0 || winlist_find(l, w) >= 0) continue;
+			winlist_append(l, w, NULL);
+			for (k = n++; k > 0 && pos[k-1] > p; k--)
+			{
+				pos[k] = pos[k-1];
+				l->array[k] = l->array[k-1];
+			}
+			pos[k] = p; l->array[k] = w;
+		}
+	}
+	free(pos);
+	return l;
 }
 
 // update current desktop on all roots
-void tag_set_current(unsigned int tag)
+void tag_set_current(bitmap tag)
 {
 	current_tag = tag; unsigned long d = tag_to_desktop(current_tag);
+	// workareas depend on which desktop-specific panels are showing
+	memset(cache_monitor, 0, sizeof(cache_monitor));
 	window_set_cardinal_prop(root, netatoms[_NET_CURRENT_DESKTOP], &d, 1);
 }
 
-// raise all windows in a tag
-void tag_raise(unsigned int tag)
+// switch to a tag as one batch of requests. shaded windows are mapped, the whole
+// stacking order is worked out from cached state and sent with one XRestackWindows,
+// and the last-focused window, already placed on top, is focused without a re-raise.
+// -taggrab holds the server meanwhile so nothing repaints halfway.
+// with -monitortags only windows on the active monitor are touched
+void tag_raise(bitmap tag)
 {
-	int i, found = 0, shaded = 0; Window w; client *c;
-	winlist *stack;
+	int i, found = 0, here = -1; Window w; client *c, *focus = NULL;
+	winlist *stack, *revealed;
+
+	if (config_monitor_tags)
+	{
+		workarea mon; monitor_active(&mon);
+		if (mon.n < MONITORS) monitor_tags[(here = mon.n)] = tag;
+	}
+
+	if (config_tag_grab) XGrabServer(display);
 
 	// if this tag was previously hidden, reveal it
 	clients_ascend(windows_shaded, i, w, c)
-		if (c->manage && c->cache->tags & tag)
-			{ client_reveal(c); shaded++; }
-	if (shaded)
+		if (c->manage && c->cache->tags & tag && (here < 0 || monitor_of_client(c) == here))
+			client_reveal(c);
+	// no XSync. client_restore() updated the cached clients, so just patch windows_in_play()
+	revealed = winlist_new();
+	clients_ascend(windows_shaded, i, w, c)
+		if (c->visible) winlist_append(revealed, w, NULL);
+	if (revealed->len) windows_in_play_add(revealed);
+	winlist_free(revealed);
+
+	// the last-focused client in the tag goes on top of its layer, with its family
+	clients_descend(windows_activated, i, w, c)
+		if (c->manage && c->cache->tags & tag && (here < 0 || monitor_of_client(c) == here)) { focus = c; break; }
+	client *top = focus;
+	for (i = 0; top && top->trans != None && i < 10; i++)
 	{
-		XSync(display, False);
-		reset_cache_xattr();
-		reset_cache_client();
-		reset_cache_inplay();
+		client *p = client_create(top->trans);
+		if (!p) break;
+		top = p;
 	}
 
 	stack = winlist_new();
 
-	// locate windows with _NET_WM_STATE_ABOVE and _NET_WM_STATE_STICKY
-	managed_descend(i, w, c)
-		if (winlist_find(stack, w) < 0 && c->visible && c->trans == None
-			&& client_has_state(c, netatoms[_NET_WM_STATE_ABOVE])
-			&& client_has_state(c, netatoms[_NET_WM_STATE_STICKY]))
-				client_stack_family(c, stack);
-	// locate windows with _NET_WM_STATE_ABOVE in this tag
-	tag_descend(i, w, c, tag)
-		if (winlist_find(stack, w) < 0 && c->visible && c->trans == None
-			&& client_has_state(c, netatoms[_NET_WM_STATE_ABOVE]))
-				{ client_stack_family(c, stack); found++; }
-	// locate _NET_WM_WINDOW_TYPE_DOCK windows
+	// one pass to sort windows into layers: sticky+above, above or fullscreen in this tag, docks, the rest.
+	// fullscreen goes over docks, as client_raise() would put it
+	winlist *layers[4] = { winlist_new(), winlist_new(), winlist_new(), winlist_new() };
 	clients_descend(windows_in_play(), i, w, c)
-		if (winlist_find(stack, w) < 0 && c->visible && c->trans == None
-			&& c->type == netatoms[_NET_WM_WINDOW_TYPE_DOCK])
-				client_stack_family(c, stack);
-	// locate all other windows in the tag
-	tag_descend(i, w, c, tag)
-		if (winlist_find(stack, w) < 0 && c->trans == None)
-			{ client_stack_family(c, stack); found++; }
+	{
+		if (!c->visible || c->trans != None) continue;
+		if (here >= 0 && monitor_of_client(c) != here) continue;
+		int above = c->manage && client_has_state(c, netatoms[_NET_WM_STATE_ABOVE]);
+		int tagged = c->manage && c->cache->tags & tag;
+		     if (above && client_has_state(c, netatoms[_NET_WM_STATE_STICKY])) winlist_append(layers[0], w, NULL);
+		else if (tagged && (above || client_has_state(c, netatoms[_NET_WM_STATE_FULLSCREEN]))) winlist_append(layers[1], w, NULL);
+		else if (c->type == netatoms[_NET_WM_WINDOW_TYPE_DOCK]) winlist_append(layers[2], w, NULL);
+		else if (tagged) winlist_append(layers[3], w, NULL);
+		else continue;
+		if (tagged) found++;
+	}
+	for (i = 0; i < 4; i++)
+	{
+		int j;
+		if (top && winlist_find(layers[i], top->window) >= 0)
+			client_stack_family(top, stack);
+		clients_ascend(layers[i], j, w, c)
+			if (winlist_find(stack, w) < 0) client_stack_family(c, stack);
+		winlist_free(layers[i]);
+	}
 
 	// raise the top window in the stack
 	if (stack->len) XRaiseWindow(display, stack->array[0]);
@@ -94,9 +173,11 @@ void tag_raise(unsigned int tag)
 	tag_set_current(tag);
 	if (config_only_auto) tag_only(tag);
 
-	// focus the last-focused client in the tag
-	clients_descend(windows_activated, i, w, c) if (c->cache->tags & tag)
-		{ client_activate(c, RAISE, WARPDEF); break; }
+	// already stacked above, unless it was minimized
+	if (focus) client_activate(focus, focus->visible ? NORAISE: RAISE, WARPDEF);
+
+	if (config_tag_grab) XUngrabServer(display);
+	XFlush(display);
 
 	// in case no windows are in the tag, show some activity
 	if (found) notice("Tag %d", tag_to_desktop(tag)+1);
@@ -114,15 +195,20 @@ void tag_auto_switch()
 	}
 }
 
-void tag_only(unsigned int tag)
+void tag_only(bitmap tag)
 {
-	int i; Window w; client *c;
+	int i, here = -1; Window w; client *c;
+	if (config_monitor_tags)
+	{
+		workarea mon; monitor_active(&mon);
+		here = mon.n;
+	}
 	managed_descend(i, w, c)
-		if (!(c->cache->tags & tag))
+		if (!(c->cache->tags & tag) && (here < 0 || monitor_of_client(c) == here))
 			client_shade(c);
 }
 
-void tag_close(unsigned int tag)
+void tag_close(bitmap tag)
 {
 	int i; Window w; client *c;
 	tag_descend(i, w, c, tag) client_close(c);
@@ -34,6 +34,7 @@ textbox* textbox_create(Window parent, bitmap flags, short x, short y, short w,
 
 	tb->x = x; tb->y = y; tb->w = MAX(1, w); tb->h = MAX(1, h);
 	tb->window = XCreateSimpleWindow(display, tb->parent, tb->x, tb->y, tb->w, tb->h, 0, None, color_get(bg));
+	account(ACCOUNT_windows, 1);
 
 	// need to preload the font to calc line height
 	textbox_font(tb, font, fg, bg);
@@ -54,14 +55,26 @@ textbox* textbox_create(Window parent, bitmap flags, short x, short y, short w,
 	return tb;
 }
 
-// set an Xft font by name
+// release the font and colors from textbox_font()
+void textbox_font_free(textbox *tb)
+{
+	if (!tb->font) return;
+	XftFontClose(display, tb->font);
+	XftColorFree(display, DefaultVisual(display, screen_id), DefaultColormap(display, screen_id), &tb->color_fg);
+	XftColorFree(display, DefaultVisual(display, screen_id), DefaultColormap(display, screen_id), &tb->color_bg);
+	account(ACCOUNT_fonts, -1); account(ACCOUNT_colors, -2);
+	tb->font = NULL;
+}
+
+// set an Xft font by name. the previous font and colors are released
 void textbox_font(textbox *tb, char *font, char *fg, char *bg)
 {
-	if (tb->font) XftFontClose(display, tb->font);
+	textbox_font_free(tb);
 	tb->font = XftFontOpenName(display, screen_id, font);
 
 	XftColorAllocName(display, DefaultVisual(display, screen_id), DefaultColormap(display, screen_id), fg, &tb->color_fg);
 	XftColorAllocName(display, DefaultVisual(display, screen_id), DefaultColormap(display, screen_id), bg, &tb->color_bg);
+	account(ACCOUNT_fonts, 1); account(ACCOUNT_colors, 2);
 }
 
 // outer code may need line height, width, etc
@@ -127,9 +140,10 @@ void textbox_free(textbox *tb)
 
 	if (tb->text) free(tb->text);
 	if (tb->prompt) free(tb->prompt);
-	if (tb->font) XftFontClose(display, tb->font);
+	textbox_font_free(tb);
 
 	XDestroyWindow(display, tb->window);
+	account(ACCOUNT_windows, -1);
 	free(tb);
 }
 
@@ -141,6 +155,7 @@ void textbox_draw(textbox *tb)
 	GC context    = XCreateGC(display, tb->window, 0, 0);
 	Pixmap canvas = XCreatePixmap(display, tb->window, tb->w, tb->h, DefaultDepth(display, screen_id));
 	XftDraw *draw = XftDrawCreate(display, canvas, DefaultVisual(display, screen_id), DefaultColormap(display, screen_id));
+	account(ACCOUNT_gcs, 1); account(ACCOUNT_pixmaps, 1);
 
 	// clear canvas
 	XftDrawRect(draw, &tb->color_bg, 0, 0, tb->w, tb->h);
@@ -199,6 +214,7 @@ void textbox_draw(textbox *tb)
 	XFreeGC(display, context);
 	XftDrawDestroy(draw);
 	XFreePixmap(display, canvas);
+	account(ACCOUNT_gcs, -1); account(ACCOUNT_pixmaps, -1);
 }
 
 // cursor handling for edit mode
@@ -0,0 +1,116 @@
+/* GoomwWM, Get out of my way, Window Manager!
+
+MIT/X11 License
+Copyright (c) 2012 Sean Pringle <sean.pringle@gmail.com>
+
+Permission is hereby granted, free of charge, to any person obtaining
+a copy of this software and associated documentation files (the
+"Software"), to deal in the Software without restriction, including
+without limitation the rights to use, copy, modify, merge, publish,
+distribute, sublicense, and/or sell copies of the Software, and to
+permit persons to whom the Software is furnished to do so, subject to
+the following conditions:
+
+The above copyright notice and this permission notice shall be
+included in all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS
+OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY
+CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT,
+TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION WITH THE
+SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+*/
+
+// current time in wheel ticks
+unsigned long long timer_now()
+{
+	return (unsigned long long)(timestamp() * 1000) / WHEELMS;
+}
+
+// schedule a callback to run in roughly ms milliseconds, from the main event loop
+int timer_add(int ms, timer_callback callback, void *data)
+{
+	int i; for (i = 0; i < TIMERS && timers[i].callback; i++);
+	if (i == TIMERS)
+	{
+		fprintf(stderr, "too many timers!\n");
+		return 0;
+	}
+	wintimer *t = &timers[i];
+	if (!timer_tick) timer_tick = timer_now();
+	// round up, so we never fire early
+	t->tick = timer_now() + (MAX(0, ms) + WHEELMS - 1) / WHEELMS;
+	t->callback = callback;
+	t->data = data;
+	t->next = timer_wheel[t->tick % WHEEL];
+	timer_wheel[t->tick % WHEEL] = t;
+	return 1;
+}
+
+// drop any pending timers matching a callback and data
+void timer_cancel(timer_callback callback, void *data)
+{
+	int i; wintimer **t;
+	for (i = 0; i < WHEEL; i++)
+	{
+		for (t = &timer_wheel[i]; *t; )
+		{
+			if ((*t)->callback == callback && (*t)->data == data)
+				{ (*t)->callback = NULL; *t = (*t)->next; }
+			else t = &(*t)->next;
+		}
+	}
+}
+
+// milliseconds until the next timer is due. -1 if nothing is pending
+int timer_next()
+{
+	int i, found = 0; wintimer *t;
+	unsigned long long now = timer_now(), next = 0;
+	// walk one rotation of the wheel from now. anything in a slot that is due
+	// within this rotation is the earliest
+	for (i = 0; i < WHEEL && !found; i++)
+	{
+		for (t = timer_wheel[(now+i) % WHEEL]; t; t = t->next)
+			if (t->tick <= now+i) { next = now+i; found = 1; break; }
+	}
+	// timers more than one rotation away
+	if (!found) for (i = 0; i < TIMERS; i++)
+		if (timers[i].callback && (!found || timers[i].tick < next))
+			{ next = timers[i].tick; found = 1; }
+	if (!found) return -1;
+
+	long long ms = (long long)(next * WHEELMS) - (long long)(timestamp() * 1000);
+	return MAX(0, (int)ms);
+}
+
+// fire any timers that are due
+void timer_run()
+{
+	unsigned long long now = timer_now(), tick;
+	wintimer *due = NULL, **t, *n;
+	if (!timer_tick) timer_tick = now;
+
+	// visit each slot passed since the last run, at most one full rotation
+	for (tick = timer_tick; tick <= now && tick < timer_tick + WHEEL; tick++)
+	{
+		for (t = &timer_wheel[tick % WHEEL]; *t; )
+		{
+			if ((*t)->tick <= now)
+				{ n = *t; *t = n->next; n->next = due; due = n; }
+			else t = &(*t)->next;
+		}
+	}
+	timer_tick = now;
+
+	// callbacks run last, so they may safely reschedule themselves
+	while (due)
+	{
+		n = due; due = n->next;
+		timer_callback callback = n->callback; n->callback = NULL;
+		callback(n->data);
+	}
+}
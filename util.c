@@ -26,7 +26,7 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 void* allocate(unsigned long bytes)
 {
-	bytes = MAX(1, bytes);
+	bytes = MAX(1, bytes); heap_allocs++;
 	void *ptr = malloc(bytes);
 	if (!ptr)
 	{
@@ -45,7 +45,7 @@ void* allocate_clear(unsigned long bytes)
 
 void* reallocate(void *ptr, unsigned long bytes)
 {
-	bytes = MAX(1, bytes);
+	bytes = MAX(1, bytes); heap_allocs++;
 	ptr = ptr ? realloc(ptr, bytes): malloc(bytes);
 	if (!ptr)
 	{
@@ -55,6 +55,85 @@ void* reallocate(void *ptr, unsigned long bytes)
 	return ptr;
 }
 
+// bump allocate from an arena. blocks are kept across resets, so once an arena
+// has grown to its working size it stops touching the heap
+void* arena_alloc(arena *a, unsigned long bytes)
+{
+	bytes = (MAX(1, bytes) + 15) & ~15UL;
+	arenablock *b = a->cur;
+	if (!b || b->used + bytes > b->size)
+	{
+		// next spare block, else a new one linked in after the current
+		if (b && b->next && b->next->size >= bytes) b = b->next;
+		else
+		{
+			unsigned long size = MAX(ARENABLOCK, bytes);
+			arenablock *n = allocate(sizeof(arenablock) + size);
+			n->size = size; n->next = b ? b->next: NULL;
+			if (b) b->next = n; else a->head = n;
+			b = n; a->blocks++; a->bytes += size;
+		}
+		b->used = 0; a->cur = b;
+	}
+	void *ptr = &b->data[b->used];
+	b->used += bytes; a->allocs++;
+	return ptr;
+}
+
+void* arena_alloc_clear(arena *a, unsigned long bytes)
+{
+	void *ptr = arena_alloc(a, bytes);
+	memset(ptr, 0, bytes);
+	return ptr;
+}
+
+// release everything in O(1). later blocks are reused as arena_alloc() reaches them
+void arena_reset(arena *a)
+{
+	if ((a->cur = a->head)) a->head->used = 0;
+	a->resets++;
+}
+
+// bytes handed out since the last reset
+unsigned long arena_used(arena *a)
+{
+	unsigned long used = 0; arenablock *b;
+	for (b = a->head; b; b = b->next)
+	{
+		used += b->used;
+		if (b == a->cur) break;
+	}
+	return used;
+}
+
+// find or add a shared copy of a string. every intern() needs an intern_release()
+char* intern(char *str)
+{
+	unsigned int hash = 5381; char *p; interned *i;
+	for (p = str; *p; p++) hash = hash * 33 + (unsigned char)*p;
+	interned **slot = &intern_table[hash % INTERNS];
+	for (i = *slot; i; i = i->next)
+		if (i->hash == hash && !strcmp(i->str, str)) { i->refs++; return i->str; }
+	i = allocate(sizeof(interned) + strlen(str) + 1);
+	i->hash = hash; i->refs = 1; strcpy(i->str, str);
+	i->next = *slot; *slot = i;
+	interned_strings++;
+	interned_bytes += sizeof(interned) + strlen(str) + 1;
+	return i->str;
+}
+
+void intern_release(char *str)
+{
+	if (!str || str == empty) return;
+	interned *i = (interned*)(str - offsetof(interned, str)), **slot;
+	if (--i->refs) return;
+	for (slot = &intern_table[i->hash % INTERNS]; *slot != i; slot = &(*slot)->next);
+	*slot = i->next;
+	interned_bytes -= sizeof(interned) + strlen(i->str) + 1;
+	free(i);
+	interned_strings--;
+}
+
 // trim string in place
 char* strtrim(char *str)
 {
@@ -83,21 +162,6 @@ int execsh(char *cmd)
 	return execlp("/bin/sh", "sh", "-c", cmd, NULL);
 }
 
-// execute sub-process
-pid_t exec_cmd(char *cmd)
-{
-	if (!cmd || !cmd[0]) return -1;
-	signal(SIGCHLD, catch_exit);
-	pid_t pid = fork();
-	if (!pid)
-	{
-		setsid();
-		execsh(cmd);
-		exit(EXIT_FAILURE);
-	}
-	return pid;
-}
-
 // cli arg handling
 int find_arg(int argc, char *argv[], char *key)
 {
@@ -117,16 +181,27 @@ int find_arg_int(int argc, char *argv[], char *key, int def)
 	return (i > 0 && i < argc-1) ? strtol(argv[i+1], NULL, 10): def;
 }
 
-// once-off regex match. don't use for repeat matching; compile instead
+// match a constant pattern. compiled regexes are kept in a small LRU cache
 int regquick(char *pat, char *str)
 {
-	regex_t re; int r = 0;
-	if (regcomp(&re, pat, REG_EXTENDED|REG_ICASE|REG_NOSUB) == 0)
+	int i, lru = 0; winregex *r = NULL;
+	for (i = 0; i < REGCACHE && !r; i++)
 	{
-		r = regexec(&re, str, 0, NULL, 0) == 0 ?1:0;
-		regfree(&re);
+		if (regex_cache[i].pattern && (regex_cache[i].pattern == pat || !strcmp(regex_cache[i].pattern, pat)))
+			r = &regex_cache[i];
+		else
+		if (regex_cache[i].used < regex_cache[lru].used) lru = i;
 	}
-	return r;
+	if (!r)
+	{
+		r = &regex_cache[lru];
+		if (r->ok) regfree(&r->re);
+		free(r->pattern);
+		r->pattern = strdup(pat);
+		r->ok = regcomp(&r->re, pat, REG_EXTENDED|REG_ICASE|REG_NOSUB) == 0 ?1:0;
+	}
+	r->used = ++regex_clock;
+	return r->ok && regexec(&r->re, str, 0, NULL, 0) == 0 ?1:0;
 }
 
 // true if keysym exists in array
@@ -138,11 +213,22 @@ int in_array_keysym(KeySym *array, KeySym code)
 }
 
 // allocate a pixel value for an X named color
+// allocated once per name and kept. colors come from a short config list, so this
+// saves a round trip per redecorate and never leaks colormap entries
 unsigned int color_get(const char *name)
 {
-	XColor color;
+	int i; XColor color;
+	for (i = 0; i < colors_len; i++)
+		if (!strcmp(colors[i].name, name)) return colors[i].pixel;
 	Colormap map = DefaultColormap(display, DefaultScreen(display));
-	return XAllocNamedColor(display, map, name, &color, &color) ? color.pixel: None;
+	if (!XAllocNamedColor(display, map, name, &color, &color)) return None;
+	account(ACCOUNT_colors, 1);
+	if (colors_len < COLORS)
+	{
+		colors[colors_len].name = strdup(name);
+		colors[colors_len++].pixel = color.pixel;
+	}
+	return color.pixel;
 }
 
 // find mouse pointer location
@@ -183,96 +269,68 @@ int modkey_is_down()
 	return 0;
 }
 
-int take_keyboard(Window w)
+// grabs are asynchronous. if another client holds one we keep servicing events and
+// retry from a timer and on focus changes, giving up after GRABMS
+int take_attempt(wingrab *g)
 {
-	int i;
-	for (i = 0; i < 1000; i++)
-	{
-		if (XGrabKeyboard(display, w, True, GrabModeAsync, GrabModeAsync, CurrentTime) == GrabSuccess)
-			return 1;
-		usleep(1000);
-	}
-	return 0;
+	int rc = g == &grab_kbd
+		? XGrabKeyboard(display, g->window, True, GrabModeAsync, GrabModeAsync, CurrentTime)
+		: XGrabPointer(display, g->window, True, g->mask, GrabModeAsync, GrabModeAsync, None, g->cursor, CurrentTime);
+	g->pending = rc == GrabSuccess ? 0:1;
+	return !g->pending;
 }
-int take_pointer(Window w, unsigned long mask, Cursor cur)
+
+void take_retry(void *data)
 {
-	int i;
-	for (i = 0; i < 1000; i++)
+	int i, again = 0;
+	wingrab *grabs[] = { &grab_kbd, &grab_ptr };
+	for (i = 0; i < 2; i++)
 	{
-		if (XGrabPointer(display, w, True, mask, GrabModeAsync, GrabModeAsync, None, cur, CurrentTime) == GrabSuccess)
-			return 1;
-		usleep(1000);
+		wingrab *g = grabs[i];
+		if (!g->pending || take_attempt(g)) continue;
+		if (timestamp() < g->deadline)
+		{
+			again = 1;
+			continue;
+		}
+		g->pending = 0;
+		notice("Could not grab %s", g == &grab_kbd ? "keyboard": "pointer");
+		if (g->failed) g->failed();
 	}
-	return 0;
+	timer_cancel(take_retry, NULL);
+	if (again) timer_add(GRABRETRYMS, take_retry, NULL);
 }
-void release_keyboard()
+
+// returns 1 if the grab is held now, 0 if still pending
+int take_grab(wingrab *g, Window w, unsigned long mask, Cursor cur, grab_callback failed)
 {
-	XUngrabKeyboard(display, CurrentTime);
+	g->window = w;
+	g->mask = mask;
+	g->cursor = cur;
+	g->failed = failed;
+	g->deadline = timestamp() + (double)GRABMS/1000;
+	if (take_attempt(g)) return 1;
+	timer_cancel(take_retry, NULL);
+	timer_add(GRABRETRYMS, take_retry, NULL);
+	return 0;
 }
-void release_pointer()
+int take_keyboard(Window w, grab_callback failed)
 {
-	XUngrabPointer(display, CurrentTime);
+	return take_grab(&grab_kbd, w, 0, None, failed);
 }
-
-// display a text message
-void message_box(int delay, int x, int y, char *fgc, char *bgc, char *bc, char *txt)
+int take_pointer(Window w, unsigned long mask, Cursor cur, grab_callback failed)
 {
-	workarea mon; monitor_dimensions_struts(x, y, &mon);
-	if (fork()) return;
-
-	display = XOpenDisplay(0x0);
-
-	box *b = box_create(root, BOX_OVERRIDE, 0, 0, 1, 1, config_title_bg);
-
-	textbox *text = textbox_create(b->window, TB_CENTER|TB_AUTOHEIGHT|TB_AUTOWIDTH,
-		8, 5, 1, 1, config_title_font, config_title_fg, config_title_bg, txt, NULL);
-
-	box_moveresize(b,
-		MIN(mon.x+mon.w-text->w-26, MAX(mon.x+26, x - text->w/2)),
-		MIN(mon.y+mon.h-text->h-20, MAX(mon.y+20, y - text->h/2)),
-		text->w + 16, text->h + 10);
-
-	XSelectInput(display, b->window, ExposureMask);
-
-	textbox_show(text);
-	box_show(b);
-
-	double stamp = timestamp();
-	while ((timestamp()-stamp) < (double)delay/1000)
-	{
-		if (XPending(display))
-		{
-			XEvent ev;
-			XNextEvent(display, &ev);
-
-			if (ev.type == Expose)
-				textbox_draw(text);
-		}
-		usleep(10000); // 10ms
-	}
-
-	textbox_free(text);
-	box_free(b);
-
-	exit(EXIT_SUCCESS);
+	return take_grab(&grab_ptr, w, mask, cur, failed);
 }
-
-// bottom right of screen
-void notice(const char *fmt, ...)
+void release_keyboard()
 {
-	char txt[100]; va_list ap;
-	va_start(ap,fmt); vsnprintf(txt, 100, fmt, ap); va_end(ap);
-	workarea mon; monitor_active(&mon);
-	message_box(SAYMS, mon.x+mon.w-1, mon.y+mon.h-1, config_title_fg, config_title_bg, config_title_bc, txt);
+	grab_kbd.pending = 0;
+	XUngrabKeyboard(display, CurrentTime);
 }
-
-// bottom left of screen
-void notification(int delay, const char *fmt, ...)
+void release_pointer()
 {
-	char txt[100]; va_list ap;
-	va_start(ap,fmt); vsnprintf(txt, 100, fmt, ap); va_end(ap);
-	workarea mon; monitor_active(&mon);
-	message_box(delay, mon.x, mon.y+mon.h-1, config_title_fg, config_title_bg, config_title_bc, txt);
+	grab_ptr.pending = 0;
+	XUngrabPointer(display, CurrentTime);
 }
 
 #ifdef DEBUG
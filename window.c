@@ -30,22 +30,179 @@ void window_select(Window w)
 	XSelectInput(display, w, EnterWindowMask | LeaveWindowMask | FocusChangeMask | PropertyChangeMask);
 }
 
-// XGetWindowAttributes with caching
+// windows goomwwm creates for itself are never managed. see client_create()
+void window_set_ours(Window w)
+{
+	int idx = winlist_find(windows, w);
+	if (idx < 0) idx = winlist_append(windows, w, allocate_clear(sizeof(wincache)));
+	((wincache*)windows->data[idx])->is_ours = 1;
+}
+
+// XGetWindowAttributes with caching. entries live in xattr_arena, so no malloc per event
 XWindowAttributes* window_get_attributes(Window w)
 {
 	int idx = winlist_find(cache_xattr, w);
 	if (idx < 0)
 	{
-		XWindowAttributes *cattr = allocate(sizeof(XWindowAttributes));
-		if (XGetWindowAttributes(display, w, cattr))
+		XWindowAttributes attr;
+		if (!XGetWindowAttributes(display, w, &attr)) return NULL;
+		XWindowAttributes *cattr = arena_alloc(&xattr_arena, sizeof(XWindowAttributes));
+		memmove(cattr, &attr, sizeof(XWindowAttributes));
+		winlist_append(cache_xattr, w, cattr);
+		return cattr;
+	}
+	return cache_xattr->data[idx];
+}
+
+// find a Visual by id on our screen. xcb replies only carry the id
+Visual* window_visual(VisualID id)
+{
+	int i, j;
+	for (i = 0; i < screen->ndepths; i++)
+		for (j = 0; j < screen->depths[i].nvisuals; j++)
+			if (screen->depths[i].visuals[j].visualid == id)
+				return &screen->depths[i].visuals[j];
+	return DefaultVisual(display, screen_id);
+}
+
+// fetch attributes, geometry and the properties client_create() and friends read
+// for every top-level window, with all requests sent before any reply is read.
+// fills cache_xattr and cache_prop, so adopting hundreds of windows at startup
+// costs a few round trips instead of several per window
+void window_prefetch()
+{
+	unsigned int nwins; int i, j, rev; Window w1, w2, *wins = NULL;
+	if (!XQueryTree(display, root, &w1, &w2, &wins, &nwins) || !wins) return;
+
+	Atom want[PREFETCH] = { atoms[WM_STATE], atoms[_MOTIF_WM_HINTS], XA_WM_TRANSIENT_FOR, XA_WM_HINTS,
+		netatoms[_NET_WM_STATE], netatoms[_NET_WM_WINDOW_TYPE], netatoms[_NET_WM_DESKTOP],
+		netatoms[_NET_WM_STRUT_PARTIAL], netatoms[_NET_WM_STRUT], netatoms[_NET_WM_PID] };
+	memmove(prefetch_atoms, want, sizeof(want));
+
+	xcb_connection_t *xcb = XGetXCBConnection(display);
+	xcb_get_window_attributes_cookie_t *ac = allocate(sizeof(xcb_get_window_attributes_cookie_t) * nwins);
+	xcb_get_geometry_cookie_t *gc = allocate(sizeof(xcb_get_geometry_cookie_t) * nwins);
+	xcb_get_property_cookie_t *pc = allocate(sizeof(xcb_get_property_cookie_t) * nwins * PREFETCH);
+
+	// Xlib may have requests buffered. they must go first
+	XFlush(display);
+	for (i = 0; i < nwins; i++)
+	{
+		ac[i] = xcb_get_window_attributes(xcb, wins[i]);
+		gc[i] = xcb_get_geometry(xcb, wins[i]);
+		for (j = 0; j < PREFETCH; j++)
+			pc[i*PREFETCH+j] = xcb_get_property(xcb, 0, wins[i], want[j], XCB_GET_PROPERTY_TYPE_ANY, 0, PREFETCHLEN);
+	}
+	xcb_flush(xcb);
+
+	if (!cache_prop) cache_prop = winlist_new();
+	XGetInputFocus(display, &cache_focus, &rev);
+
+	for (i = 0; i < nwins; i++)
+	{
+		xcb_get_window_attributes_reply_t *ar = xcb_get_window_attributes_reply(xcb, ac[i], NULL);
+		xcb_get_geometry_reply_t *gr = xcb_get_geometry_reply(xcb, gc[i], NULL);
+		winprops *props = allocate_clear(sizeof(winprops));
+
+		for (j = 0; j < PREFETCH; j++)
 		{
-			winlist_append(cache_xattr, w, cattr);
-			return cattr;
+			xcb_get_property_reply_t *pr = xcb_get_property_reply(xcb, pc[i*PREFETCH+j], NULL);
+			if (pr && pr->type != XCB_NONE && pr->format)
+			{
+				winprop *p = &props->prop[props->count++];
+				int k, n = xcb_get_property_value_length(pr) / (pr->format/8);
+				void *v = xcb_get_property_value(pr);
+				p->atom = want[j]; p->type = pr->type; p->format = pr->format; p->items = n;
+				p->complete = pr->bytes_after == 0;
+				// Xlib hands back format 32 data as longs
+				if (pr->format == 32)
+				{
+					unsigned long *l = allocate(sizeof(unsigned long) * (n+1));
+					for (k = 0; k < n; k++) l[k] = ((uint32_t*)v)[k];
+					p->value = l;
+				}
+				else
+				{
+					p->value = allocate(xcb_get_property_value_length(pr) + 1);
+					memmove(p->value, v, xcb_get_property_value_length(pr));
+				}
+			}
+			free(pr);
 		}
-		free(cattr);
-		return NULL;
+		if (ar && gr && winlist_find(cache_xattr, wins[i]) < 0)
+		{
+			XWindowAttributes *attr = arena_alloc_clear(&xattr_arena, sizeof(XWindowAttributes));
+			attr->x = gr->x; attr->y = gr->y; attr->width = gr->width; attr->height = gr->height;
+			attr->border_width = gr->border_width; attr->depth = gr->depth; attr->root = gr->root;
+			attr->visual = window_visual(ar->visual); attr->class = ar->_class;
+			attr->bit_gravity = ar->bit_gravity; attr->win_gravity = ar->win_gravity;
+			attr->backing_store = ar->backing_store; attr->backing_planes = ar->backing_planes;
+			attr->backing_pixel = ar->backing_pixel; attr->save_under = ar->save_under;
+			attr->colormap = ar->colormap; attr->map_installed = ar->map_is_installed;
+			attr->map_state = ar->map_state; attr->all_event_masks = ar->all_event_masks;
+			attr->your_event_mask = ar->your_event_mask; attr->do_not_propagate_mask = ar->do_not_propagate_mask;
+			attr->override_redirect = ar->override_redirect; attr->screen = screen;
+			winlist_append(cache_xattr, wins[i], attr);
+		}
+		winlist_append(cache_prop, wins[i], props);
+		free(ar); free(gr);
 	}
-	return cache_xattr->data[idx];
+	free(ac); free(gc); free(pc);
+	XFree(wins);
+}
+
+// drop prefetched properties. writes drop a window's own entry as they happen
+void window_prefetch_free()
+{
+	int i, j;
+	if (!cache_prop) return;
+	for (i = 0; i < cache_prop->len; i++)
+	{
+		winprops *props = cache_prop->data[i];
+		for (j = 0; j < props->count; j++) free(props->prop[j].value);
+	}
+	winlist_free(cache_prop);
+	cache_prop = NULL;
+}
+
+// we're writing a property, so the window's prefetched values are stale
+void window_prefetch_forget(Window w)
+{
+	int j, idx = cache_prop ? winlist_find(cache_prop, w): -1;
+	if (idx < 0) return;
+	winprops *props = cache_prop->data[idx];
+	for (j = 0; j < props->count; j++) free(props->prop[j].value);
+	winlist_forget(cache_prop, w);
+}
+
+// look in cache_prop. -1 if not prefetched, else as window_get_prop()
+int window_get_prefetched(Window w, Atom prop, Atom *type, int *items, void *buffer, int bytes)
+{
+	int i, idx = winlist_find(cache_prop, w);
+	if (idx < 0) return -1;
+	for (i = 0; i < PREFETCH && prefetch_atoms[i] != prop; i++);
+	if (i == PREFETCH) return -1;
+	winprops *props = cache_prop->data[idx];
+	for (i = 0; i < props->count && props->prop[i].atom != prop; i++);
+	// fetched, but not set on the window
+	if (i == props->count) { *type = None; *items = 0; return 0; }
+	winprop *p = &props->prop[i];
+	// same truncation as a live request for bytes/4 32bit units
+	int max = (bytes/4) * (32/p->format);
+	if (!p->complete && p->items < max) return -1;
+	int n = MIN(p->items, max), size = p->format == 32 ? sizeof(long): p->format/8;
+	memmove(buffer, p->value, MIN(bytes, n * size));
+	*type = p->type; *items = n;
+	return 1;
+}
+
+// XGetInputFocus, or the value read by window_prefetch()
+Window window_focus()
+{
+	Window focus; int rev;
+	if (cache_prop) return cache_focus;
+	XGetInputFocus(display, &focus, &rev);
+	return focus;
 }
 
 // retrieve a property of any type from a window
@@ -56,6 +213,9 @@ int window_get_prop(Window w, Atom prop, Atom *type, int *items, void *buffer, i
 	int format; unsigned long nitems, nbytes; unsigned char *ret = NULL;
 	memset(buffer, 0, bytes);
 
+	if (cache_prop && (format = window_get_prefetched(w, prop, type, items, buffer, bytes)) >= 0)
+		return format;
+
 	if (XGetWindowProperty(display, w, prop, 0, bytes/4, False, AnyPropertyType, type,
 		&format, &nitems, &nbytes, &ret) == Success && ret && *type != None && format)
 	{
@@ -72,30 +232,28 @@ int window_get_prop(Window w, Atom prop, Atom *type, int *items, void *buffer, i
 // technically we could use window_get_prop(), but this is better for character set support
 char* window_get_text_prop(Window w, Atom atom)
 {
-	XTextProperty prop; char *res = NULL;
+	XTextProperty prop; char *res = NULL, *str = NULL;
 	char **list = NULL; int count;
 	if (XGetTextProperty(display, w, &prop, atom) && prop.value && prop.nitems)
 	{
 		if (prop.encoding == XA_STRING)
-		{
-			res = allocate(strlen((char*)prop.value)+1);
-			strcpy(res, (char*)prop.value);
-		}
+			str = (char*)prop.value;
 		else
 		if (XmbTextPropertyToTextList(display, &prop, &list, &count) >= Success && count > 0 && *list)
-		{
-			res = allocate(strlen(*list)+1);
-			strcpy(res, *list);
-			XFreeStringList(list);
-		}
+			str = *list;
+		if (str)
+			res = strcpy(allocate(strlen(str)+1), str);
+		if (list) XFreeStringList(list);
 	}
 	if (prop.value) XFree(prop.value);
 	return res;
 }
 
+
 int window_set_text_prop(Window w, Atom atom, char *txt)
 {
 	XTextProperty prop;
+	window_prefetch_forget(w);
 	if (XStringListToTextProperty(&txt, 1, &prop))
 	{
 		XSetTextProperty(display, w, &prop, atom);
@@ -112,6 +270,7 @@ int window_get_atom_prop(Window w, Atom atom, Atom *list, int count)
 
 void window_set_atom_prop(Window w, Atom prop, Atom *atoms, int count)
 {
+	window_prefetch_forget(w);
 	XChangeProperty(display, w, prop, XA_ATOM, 32, PropModeReplace, (unsigned char*)atoms, count);
 }
 
@@ -121,13 +280,24 @@ int window_get_cardinal_prop(Window w, Atom atom, unsigned long *list, int count
 	return window_get_prop(w, atom, &type, &items, list, count*sizeof(unsigned long)) && type == XA_CARDINAL ? items:0;
 }
 
+// note whether a window reserves screen space, so workarea updates only look at those
+// that do. select PropertyChangeMask first, and handle_propertynotify() keeps it current
+void window_check_struts(Window w, wincache *cache)
+{
+	unsigned long strut[12];
+	cache->has_struts = window_get_cardinal_prop(w, netatoms[_NET_WM_STRUT_PARTIAL], strut, 12)
+		|| window_get_cardinal_prop(w, netatoms[_NET_WM_STRUT], strut, 4);
+}
+
 void window_set_cardinal_prop(Window w, Atom prop, unsigned long *values, int count)
 {
+	window_prefetch_forget(w);
 	XChangeProperty(display, w, prop, XA_CARDINAL, 32, PropModeReplace, (unsigned char*)values, count);
 }
 
 void window_unset_prop(Window w, Atom prop)
 {
+	window_prefetch_forget(w);
 	XDeleteProperty(display, w, prop);
 }
 
@@ -165,6 +335,25 @@ winlist* windows_in_play()
 	return cache_inplay;
 }
 
+// add windows we've just mapped to windows_in_play() in their stacking position,
+// without waiting for the server to report them viewable
+void windows_in_play_add(winlist *mapped)
+{
+	unsigned int nwins; int i; Window w1, w2, *wins;
+	winlist *inplay = windows_in_play(), *old = winlist_new();
+	for (i = 0; i < inplay->len; i++) winlist_append(old, inplay->array[i], NULL);
+	if (XQueryTree(display, root, &w1, &w2, &wins, &nwins) && wins)
+	{
+		inplay->len = 0;
+		for (i = 0; i < nwins; i++)
+			if (winlist_find(old, wins[i]) >= 0 || winlist_find(mapped, wins[i]) >= 0)
+				winlist_append(inplay, wins[i], NULL);
+	}
+	if (wins) XFree(wins);
+	winlist_free(old);
+	reset_cache_tagged();
+}
+
 // top-level windows, visible or not. DOES include non-managable docks/panels
 winlist* window_children()
 {
@@ -24,9 +24,17 @@ SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 */
 
+// lists come from the spare pool when possible. most are temporaries built and
+// freed within one event, so the steady state does no heap allocation
 winlist* winlist_new()
 {
-	winlist *l = allocate(sizeof(winlist)); l->len = 0;
+	if (winlist_pooled > 0)
+	{
+		winlist *l = winlist_pool[--winlist_pooled];
+		l->len = 0;
+		return l;
+	}
+	winlist *l = allocate(sizeof(winlist)); l->len = 0; l->size = WINLIST;
 	l->array = allocate(sizeof(Window) * (WINLIST+1));
 	l->data  = allocate(sizeof(void*) * (WINLIST+1));
 	return l;
@@ -34,10 +42,11 @@ winlist* winlist_new()
 
 int winlist_append(winlist *l, Window w, void *d)
 {
-	if (l->len > 0 && !(l->len % WINLIST))
+	if (l->len == l->size)
 	{
-		l->array = reallocate(l->array, sizeof(Window) * (l->len+WINLIST+1));
-		l->data  = reallocate(l->data,  sizeof(void*)  * (l->len+WINLIST+1));
+		l->size += WINLIST;
+		l->array = reallocate(l->array, sizeof(Window) * (l->size+1));
+		l->data  = reallocate(l->data,  sizeof(void*)  * (l->size+1));
 	}
 	l->data[l->len] = d;
 	l->array[l->len++] = w;
@@ -58,9 +67,13 @@ void winlist_empty(winlist *l)
 	while (l->len > 0) free(l->data[--(l->len)]);
 }
 
+// pooled lists keep whatever capacity they grew to, so reusing a big one
+// doesn't realloc again
 void winlist_free(winlist *l)
 {
-	winlist_empty(l); free(l->array); free(l->data); free(l);
+	winlist_empty(l);
+	if (winlist_pooled < WINLISTPOOL) { winlist_pool[winlist_pooled++] = l; return; }
+	free(l->array); free(l->data); free(l);
 }
 
 int winlist_find(winlist *l, Window w)
@@ -94,3 +107,50 @@ void winlist_reverse(winlist *l)
 		l->array[j] = w; l->data[j] = d;
 	}
 }
+
+// resize a ring, keeping the newest cells
+void winring_resize(winring *r, int size)
+{
+	int i, n = MIN(r->len, size);
+	winundo *cells = allocate_clear(sizeof(winundo) * size);
+	for (i = 0; i < n; i++) cells[n-1-i] = r->cells[(r->top-i+r->size) % r->size];
+	free(r->cells);
+	r->cells = cells; r->size = size; r->len = n;
+	r->top = (n-1+size) % size;
+}
+
+// a cleared cell on top of the ring, depth deep
+winundo* winring_push(winring *r, int depth)
+{
+	if (r->size != depth) winring_resize(r, depth);
+	r->top = (r->top+1) % r->size;
+	r->len = MIN(r->len+1, r->size);
+	winundo *u = &r->cells[r->top];
+	memset(u, 0, sizeof(winundo));
+	return u;
+}
+
+// the cell i below the top. 0 is the newest
+winundo* winring_at(winring *r, int i)
+{
+	return i >= 0 && i < r->len ? &r->cells[(r->top-i+r->size) % r->size]: NULL;
+}
+
+winundo* winring_top(winring *r)
+{
+	return winring_at(r, 0);
+}
+
+// remove the top cell. it stays readable until the next push
+winundo* winring_pop(winring *r)
+{
+	winundo *u = winring_top(r);
+	if (u) { r->top = (r->top-1+r->size) % r->size; r->len--; }
+	return u;
+}
+
+void winring_free(winring *r)
+{
+	free(r->cells);
+	memset(r, 0, sizeof(winring));
+}
@@ -46,18 +46,30 @@ void reset_lazy_caches()
 }
 void reset_cache_xattr()
 {
-	winlist_empty(cache_xattr);
+	// entries are in xattr_arena
+	cache_xattr->len = 0;
+	arena_reset(&xattr_arena);
 }
 void reset_cache_client()
 {
-	int i; Window w;
-	winlist_ascend(cache_client, i, w)
-		client_free(cache_client->data[i]);
+	// records are in client_arena, so no per-client free
 	cache_client->len = 0;
+	arena_reset(&client_arena);
 }
 void reset_cache_inplay()
 {
 	winlist_empty(cache_inplay);
+	reset_cache_tagged();
+}
+void reset_cache_tagged()
+{
+	int i; Window w;
+	// keep the lists, so a loop still walking one just ends
+	winlist_ascend(cache_tagged, i, w)
+	{
+		cache_tagged->array[i] = 0;
+		((winlist*)cache_tagged->data[i])->len = 0;
+	}
 }
 
 // an X screen. may have multiple monitors, xinerama, etc
@@ -65,6 +77,7 @@ void setup_screen()
 {
 	int i; Window w;
 	supporting = XCreateSimpleWindow(display, root, 0, 0, 1, 1, 0, 0, 0);
+	account(ACCOUNT_windows, 1);
 	unsigned long pid = getpid();
 
 	// EWMH
@@ -79,21 +92,36 @@ void setup_screen()
 	// become the window manager here
 	XSelectInput(display, root, StructureNotifyMask | SubstructureRedirectMask | SubstructureNotifyMask);
 
-	// setup any existing windows
+	// setup any existing windows. those in a restart snapshot keep their old state.
+	// attributes and properties are read for all of them up front
+	window_prefetch();
 	winlist *l = window_children();
+	winlist *restored = snapshot_load(l);
+	// every panel is known before any window gets placed below
 	winlist_ascend(l, i, w)
 	{
-		wincache *cache = allocate_clear(sizeof(wincache));
-		winlist_append(windows, w, cache);
+		int idx = winlist_find(windows, w);
+		if (idx < 0) idx = winlist_append(windows, w, allocate_clear(sizeof(wincache)));
+		XWindowAttributes *attr = window_get_attributes(w);
+		if (!attr || attr->override_redirect) continue;
+		XSelectInput(display, w, PropertyChangeMask);
+		window_check_struts(w, windows->data[idx]);
+	}
+	winlist_ascend(l, i, w)
+	{
+		int was_restored = winlist_find(restored, w) >= 0;
 		client *c = client_create(w);
 		if (c && c->manage && (c->visible || client_get_wm_state(c) == IconicState))
 		{
 			window_select(c->window);
-			winlist_append(c->visible ? windows_activated: windows_shaded, c->window, NULL);
+			if (!was_restored)
+				winlist_append(c->visible ? windows_activated: windows_shaded, c->window, NULL);
 			client_full_review(c);
 		}
 	}
+	winlist_free(restored);
 	winlist_free(l);
+	window_prefetch_free();
 	// activate and focus top window
 	client_active(0);
 	ewmh_client_list();
@@ -155,6 +183,10 @@ void setup_keyboard_options(int ac, char *av[])
 			config_modkeycodes[i++] = modmap->modifiermap[7*modmap->max_keypermod+j];
 	XFreeModifiermap(modmap);
 
+	// start from the defaults, in case this is a reload
+	memmove(keymap, keymap_default, sizeof(keymap));
+	memmove(keymodmap, keymodmap_default, sizeof(keymodmap));
+
 	// everything defaults to modkey
 	for (i = 0; keyargs[i]; i++)
 		keymodmap[i] |= config_modkey;
@@ -186,7 +218,7 @@ void setup_keyboard_options(int ac, char *av[])
 
 	// check for prefix key mode
 	config_prefix_mode = keymap[KEY_PREFIX] == XK_VoidSymbol ? NOPREFIX: PREFIX;
-	prefix_cursor = XCreateFontCursor(display, XC_icon);
+	if (!prefix_cursor) prefix_cursor = XCreateFontCursor(display, XC_icon);
 }
 
 void setup_general_options(int ac, char *av[])
@@ -285,6 +317,18 @@ void setup_general_options(int ac, char *av[])
 	// autohide non-current tags
 	config_only_auto = find_arg(ac, av, "-onlyauto") >= 0 ? 1:0;
 
+	// number of tags, which are also EWMH desktops
+	config_tags = MAX(1, MIN(TAGS, find_arg_int(ac, av, "-tags", TAGSDEF)));
+
+	// undo history per window
+	config_undo = MAX(1, MIN(UNDOMAX, find_arg_int(ac, av, "-undodepth", UNDO)));
+
+	// each monitor switches tags independently
+	config_monitor_tags = find_arg(ac, av, "-monitortags") >= 0 ? 1:0;
+
+	// hold the server during tag switches
+	config_tag_grab = find_arg(ac, av, "-taggrab") >= 0 ? 1:0;
+
 	// resize hints mode
 	config_resize_inc = SMARTRESIZEINC;
 	config_resizeinc_ignore = SMARTRESIZEINC_IGNORE;
@@ -292,6 +336,12 @@ void setup_general_options(int ac, char *av[])
 	     if (!strcasecmp(mode, "all"))  config_resize_inc = RESIZEINC;
 	else if (!strcasecmp(mode, "none")) config_resize_inc = NORESIZEINC;
 	else if (strcasecmp(mode, "smart")) config_resizeinc_ignore = mode;
+	if (regcomp(&config_resizeinc_re, config_resizeinc_ignore, REG_EXTENDED|REG_ICASE|REG_NOSUB) != 0)
+	{
+		fprintf(stderr, "failed to compile regex: %s\n", config_resizeinc_ignore);
+		config_resizeinc_ignore = SMARTRESIZEINC_IGNORE;
+		regcomp(&config_resizeinc_re, config_resizeinc_ignore, REG_EXTENDED|REG_ICASE|REG_NOSUB);
+	}
 
 	// menu select mode
 	config_menu_select = MENURETURN;
@@ -301,10 +351,12 @@ void setup_general_options(int ac, char *av[])
 		if (!strcasecmp(mode, "modkeyup")) config_menu_select = MENUMODUP;
 	}
 
-	// optionally swap tag and app key
+	// optionally swap tag and app key. remember the swap so a reload doesn't undo it
 	mode = find_arg_str(ac, av, "-appkeys", "numbers");
-	if (!strcasecmp(mode, "functions"))
+	int swap = strcasecmp(mode, "functions") ? 0: 1;
+	if (swap != config_appkeys_swapped)
 	{
+		config_appkeys_swapped = swap;
 		for (i = 0; i < sizeof(config_apps_keysyms)/sizeof(KeySym); i++)
 		{
 			KeySym k = config_apps_keysyms[i];
@@ -346,17 +398,20 @@ void setup_rule_options(int ac, char *av[])
 	}
 	config_rulesets->rules = config_rules;
 
+	// rule profile on exit
+	config_rule_stats = find_arg(ac, av, "-rulestats") >= 0 ? 1:0;
+
 	// default to first rule set
 	winruleset *set = config_rulesets;
+	for (; set; set = set->next) ruleset_compile(set);
+	set = config_rulesets;
 	while (set->next) set = set->next;
 	config_rules = set->rules;
 }
 
-// window manager
-int wm_main(int argc, char *argv[])
+// merge command line args with those from -config or ~/.goomwwmrc
+char** config_args(int argc, char *argv[], int *count)
 {
-	int i; XEvent ev;
-
 	// prepare to fall back on ~/.goomwwmrc
 	char *conf_home = NULL, *home = getenv("HOME");
 	if (home)
@@ -366,7 +421,7 @@ int wm_main(int argc, char *argv[])
 	}
 
 	// prepare args and merge conf file args
-	int ac = argc; char **av = argv, *conf;
+	int i, ac = argc; char **av = argv, *conf;
 	if ((conf = find_arg_str(argc, argv, "-config", conf_home)))
 	{
 		// new list for both sets of args
@@ -403,10 +458,119 @@ int wm_main(int argc, char *argv[])
 	for (i = 0; i < ac; i++)
 		printf("arg: [%s]\n", av[i]);
 #endif
+	*count = ac;
+	return av;
+}
+
+// release a config_args() list. entries past argc came from the config file
+void config_args_free(int argc, char *argv[], int ac, char *av[])
+{
+	int i;
+	if (av == argv) return;
+	for (i = argc; i < ac; i++) free(av[i]);
+	free(av);
+}
+
+// compare the rule related args of two lists
+int config_rules_differ(int ac1, char *av1[], int ac2, char *av2[])
+{
+	int i = 0, j = 0;
+	for (;;)
+	{
+		while (i < ac1 && strcasecmp(av1[i], "-rule") && strcasecmp(av1[i], "-ruleset")) i++;
+		while (j < ac2 && strcasecmp(av2[j], "-rule") && strcasecmp(av2[j], "-ruleset")) j++;
+		if (i >= ac1-1 || j >= ac2-1) return (i >= ac1-1) != (j >= ac2-1);
+		if (strcasecmp(av1[i], av2[j]) || strcmp(av1[i+1], av2[j+1])) return 1;
+		i += 2; j += 2;
+	}
+}
+
+// re-read the config and apply it in place. managed windows keep their tags, undo
+// chains and locks; keys are regrabbed only where they changed, rules are rebuilt
+// only when the rule args changed, and decorations pick up new colors and fonts
+void wm_reload()
+{
+	int i, argc = 0, ac; char **av;
+	while (loop_argv[argc]) argc++;
+	av = config_args(argc, loop_argv, &ac);
+
+	int old_border = config_border_width, old_titlebar = config_titlebar_height;
+	unsigned int old_tags = config_tags, old_monitor_tags = config_monitor_tags;
+	KeySym old_syms[GRABCOMBOS]; unsigned int old_masks[GRABCOMBOS];
+	int old_n = grab_combos(old_syms, old_masks);
+
+	// remember outer geometry so windows stay put if decoration sizes change.
+	// shaded and minimized windows are unmapped, but get the same treatment
+	winlist *places = winlist_new(), *hidden[2] = { windows_shaded, windows_minimized };
+	client *c; Window w; int j;
+	managed_ascend(i, w, c)
+	{
+		client_extended_data(c);
+		workarea *wa = allocate(sizeof(workarea));
+		wa->x = c->x; wa->y = c->y; wa->w = c->w; wa->h = c->h;
+		winlist_append(places, w, wa);
+	}
+	for (j = 0; j < 2; j++) clients_ascend(hidden[j], i, w, c)
+	{
+		if (!c->manage || winlist_find(places, w) >= 0) continue;
+		client_extended_data(c);
+		workarea *wa = allocate(sizeof(workarea));
+		wa->x = c->x; wa->y = c->y; wa->w = c->w; wa->h = c->h;
+		winlist_append(places, w, wa);
+	}
+
+	setup_keyboard_options(ac, av);
+	regfree(&config_resizeinc_re);
+	setup_general_options(ac, av);
+	// windows are already tagged for the old count. -restart to change it
+	int tags_changed = config_tags != old_tags;
+	config_tags = old_tags;
+	// monitors start out on whatever tag is showing now
+	if (config_monitor_tags && !old_monitor_tags)
+		for (i = 0; i < MONITORS; i++) monitor_tags[i] = current_tag;
+	if (config_rules_differ(config_ac, config_av, ac, av))
+	{
+		ruleset_free_all();
+		setup_rule_options(ac, av);
+	}
+	else config_rule_stats = find_arg(ac, av, "-rulestats") >= 0 ? 1:0;
+	grab_keys_update(old_syms, old_masks, old_n);
+
+	// config strings now point into the new list
+	config_args_free(argc, loop_argv, config_ac, config_av);
+	config_ac = ac; config_av = av;
+
+	// new fonts and colors for existing decorations
+	notice_reset();
+	reset_lazy_caches();
+	for (i = 0; i < places->len; i++)
+	{
+		if (!(c = client_create(places->array[i])) || !c->manage) continue;
+		workarea *wa = places->data[i];
+		client_review_title(c);
+		if (config_border_width != old_border || config_titlebar_height != old_titlebar)
+			client_moveresize(c, 0, wa->x, wa->y, wa->w, wa->h);
+		client_redecorate(c);
+	}
+	winlist_free(places);
+	reset_lazy_caches();
+	XFlush(display);
+	notice(tags_changed ? "Reloaded %d args, -tags needs -restart": "Reloaded %d args", ac);
+}
+
+// window manager
+int wm_main(int argc, char *argv[])
+{
+	int i; XEvent ev;
+
+	config_av = config_args(argc, argv, &config_ac);
+	int ac = config_ac; char **av = config_av;
+
 	// caches to reduce X server round trips during a single event
 	cache_client = winlist_new();
 	cache_xattr  = winlist_new();
 	cache_inplay = winlist_new();
+	cache_tagged = winlist_new();
 	memset(cache_monitor, 0, sizeof(cache_monitor));
 
 	// window tracking
@@ -414,6 +578,8 @@ int wm_main(int argc, char *argv[])
 	windows_activated = winlist_new();
 	windows_minimized = winlist_new();
 	windows_shaded    = winlist_new();
+	for (i = 0; i < TAGS; i++) tag_members[i] = winlist_new();
+	for (i = 0; i < MONITORS; i++) monitor_tags[i] = current_tag;
 
 	// do this before setting error handler, so it fails if other wm in place
 	XSelectInput(display, DefaultRootWindow(display), SubstructureRedirectMask);
@@ -424,21 +590,23 @@ int wm_main(int argc, char *argv[])
 	setup_rule_options(ac, av);
 	setup_screen();
 	grab_keys_and_buttons();
+	loop_setup(argv);
+	ipc_setup();
+
+	// rule profile on exit
+	atexit(rule_dump_exit);
+	// first resource sample, then every ACCOUNTMS
+	account_sample(NULL);
 
 	// auto start stuff
-	if (!fork())
+	for (i = 0; i < ac-1; i++)
 	{
-		display = XOpenDisplay(0);
-		for (i = 0; i < ac-1; i++)
+		if (!strcasecmp(av[i], "-exec")) exec_cmd(av[i+1]);
+		else if (!strcasecmp(av[i], "-auto"))
 		{
-			if (!strcasecmp(av[i], "-exec")) exec_cmd(av[i+1]);
-			else if (!strcasecmp(av[i], "-auto"))
-			{
-				client *a = client_find(av[i+1]);
-				if (!a) client_start(av[i+1]);
-			}
+			client *a = client_find(av[i+1]);
+			if (!a) client_start(av[i+1]);
 		}
-		exit(EXIT_SUCCESS);
 	}
 
 	// be polite
@@ -449,11 +617,15 @@ int wm_main(int argc, char *argv[])
 	for(;;)
 	{
 		reset_cache_xattr();
+		// handlers reset the client cache often, but bound client_arena if they haven't
+		if (arena_used(&client_arena) > CLIENTARENA) reset_cache_client();
 
-		// block and wait for something
+		// block and wait for something, running timers, signals and fd callbacks
+		if (!loop_wait()) continue;
 		XNextEvent(display, &ev);
 		if (ev.type == MappingNotify) handle_mappingnotify(&ev);
 		if (ev.xany.window == None) continue;
+		if (menu_event(&ev)) continue;
 
 		     if (ev.type == KeyPress)         handle_keypress(&ev);
 		else if (ev.type == ButtonPress)      handle_buttonpress(&ev);
@@ -470,6 +642,8 @@ int wm_main(int argc, char *argv[])
 		else if (ev.type == PropertyNotify)   handle_propertynotify(&ev);
 		else if (ev.type == EnterNotify)      handle_enternotify(&ev);
 		else if (ev.type == Expose)           handle_expose(&ev);
+		else if (ev.type == FocusIn)          handle_focus(&ev);
+		else if (ev.type == FocusOut)         handle_focus(&ev);
 #ifdef DEBUG
 		else fprintf(stderr, "unhandled event %d: %x\n", ev.type, (unsigned int)ev.xany.window);
 		catch_exit(0);